@@ -0,0 +1,516 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Connection.h"
+#include "Delegate.h"
+
+/**
+ * @file ConcurrentEvent.h
+ * @brief Thread-safe event whose Trigger never takes a lock.
+ *
+ * Listeners are published as immutable snapshots swapped atomically on each mutation (copy-on-write),
+ * and old snapshots are reclaimed once no thread can still be reading them (epoch-based reclamation).
+ */
+
+namespace event_detail {
+
+    /**
+     * @brief Epoch-based reclamation domain shared by every ConcurrentEvent.
+     *
+     * A reader owns a cache-line sized slot for the duration of its outermost read section and
+     * announces the current global epoch in it before reading a snapshot. A snapshot retired at
+     * epoch E can be freed once every announced epoch is greater than E. A thread first tries the
+     * slot it used last, which is usually still free, so taking a slot is a single uncontended CAS.
+     */
+    class EpochDomain {
+    public:
+        /// Maximum number of threads inside a read section at the same time, others wait for a slot to be released.
+        static constexpr std::size_t MaxReaders = 256;
+
+        /// Epoch announced by a thread that is not reading
+        static constexpr std::uint64_t Idle = 0;
+
+    private:
+        struct alignas(64) ReaderSlot {
+            std::atomic<std::uint64_t> epoch{ Idle }; ///< Epoch announced by the owning thread
+            std::atomic<bool> owned{ false };         ///< Whether a thread owns this slot
+        };
+
+        /// Read state of the calling thread
+        struct ThreadRecord {
+            ReaderSlot* slot = nullptr; ///< Slot owned during the outermost read section, nullptr outside
+            std::size_t hint = 0;       ///< Index of the slot used last
+            unsigned depth = 0;         ///< Number of nested read sections
+        };
+
+        std::atomic<std::uint64_t> _epoch{ 1 };
+        std::atomic<std::size_t> _slotCount{ 0 }; ///< High-water mark of the slots ever owned
+        ReaderSlot _readers[MaxReaders];
+
+        static ThreadRecord& Record() {
+            static thread_local ThreadRecord record;
+            return record;
+        }
+
+        bool TryAcquire(std::size_t i) {
+            bool expected = false;
+            if (_readers[i].owned.load(std::memory_order_relaxed)
+                || !_readers[i].owned.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                return false;
+            std::size_t count = _slotCount.load(std::memory_order_relaxed);
+            while (count < i + 1 && !_slotCount.compare_exchange_weak(count, i + 1, std::memory_order_seq_cst)) {}
+            return true;
+        }
+
+        /// Take a free slot, starting with the one used last. Waits while MaxReaders threads are reading.
+        ReaderSlot* AcquireSlot(std::size_t& hint) {
+            if (TryAcquire(hint))
+                return &_readers[hint];
+            for (;;) {
+                for (std::size_t i = 0; i < MaxReaders; ++i) {
+                    if (TryAcquire(i)) {
+                        hint = i;
+                        return &_readers[i];
+                    }
+                }
+                std::this_thread::yield();
+            }
+        }
+
+    public:
+
+        /// @return The domain shared by the whole program.
+        static EpochDomain& Instance() {
+            static EpochDomain domain;
+            return domain;
+        }
+
+        /**
+         * @brief Start a read section, nested sections keep the epoch of the outermost one.
+         */
+        void Enter() {
+            ThreadRecord& record = Record();
+            if (record.depth++ != 0)
+                return;
+            record.slot = AcquireSlot(record.hint);
+            record.slot->epoch.store(_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+        }
+
+        /**
+         * @brief End a read section.
+         */
+        void Leave() {
+            ThreadRecord& record = Record();
+            if (--record.depth == 0) {
+                record.slot->epoch.store(Idle, std::memory_order_release);
+                record.slot->owned.store(false, std::memory_order_release);
+                record.slot = nullptr;
+            }
+        }
+
+        /**
+         * @brief Move to the next epoch, to be called after unpublishing a snapshot.
+         * @return The epoch to retire the unpublished snapshot with.
+         */
+        std::uint64_t Advance() {
+            return _epoch.fetch_add(1, std::memory_order_seq_cst);
+        }
+
+        /**
+         * @return The oldest epoch announced by a reader, UINT64_MAX if no thread is reading.
+         * @param ignoreCaller Skip the calling thread, which cannot be waited for from its own read section.
+         */
+        std::uint64_t OldestReader(bool ignoreCaller = false) const {
+            const ReaderSlot* own = ignoreCaller ? Record().slot : nullptr;
+            std::uint64_t oldest = UINT64_MAX;
+            std::size_t count = _slotCount.load(std::memory_order_seq_cst);
+            for (std::size_t i = 0; i < count; ++i) {
+                std::uint64_t epoch = _readers[i].epoch.load(std::memory_order_seq_cst);
+                if (epoch != Idle && epoch < oldest && &_readers[i] != own)
+                    oldest = epoch;
+            }
+            return oldest;
+        }
+
+        /**
+         * @brief Wait until every read section started before the call has ended.
+         */
+        void Synchronize() {
+            std::uint64_t epoch = Advance();
+            while (OldestReader(true) <= epoch)
+                std::this_thread::yield();
+        }
+
+        /**
+         * @brief RAII read section.
+         */
+        class ReadGuard {
+            EpochDomain& _domain;
+        public:
+            explicit ReadGuard(EpochDomain& domain) : _domain(domain) { _domain.Enter(); }
+            ~ReadGuard() { _domain.Leave(); }
+            ReadGuard(const ReadGuard&) = delete;
+            ReadGuard& operator=(const ReadGuard&) = delete;
+        };
+    };
+
+}
+
+/**
+ * @brief Thread-safe Event, with a lock-free Trigger.
+ *
+ * Trigger only announces its epoch, loads the current listener snapshot and walks it, so readers
+ * scale with the number of threads. AddListener and RemoveListener copy the listener list, publish
+ * the copy and serialize among themselves with a mutex: they are meant to be rare.
+ *
+ * A listener removed while another thread is dispatching may still be called by that dispatch.
+ * Call Synchronize() after removing a listener and before destroying its object to wait for
+ * those dispatches to end.
+ *
+ * ScopedConnection works with this event, but a given ScopedConnection must not be used from
+ * several threads at the same time.
+ *
+ * @tparam Types Variadic template representing the argument types passed to the listeners.
+ */
+template <typename... Types>
+class ConcurrentEvent : public event_detail::ConnectionOwner {
+
+    /// Internal non-allocating function wrapper type, receiving the arguments as passed by Trigger
+    using Callback = Delegate<void(event_detail::Param<Types>...)>;
+
+    /**
+     * @brief Internal representation of a registered listener.
+     */
+    struct Listener {
+        void* instancePtr;   ///< Pointer to the object instance (or nullptr for free functions)
+        event_detail::FunctionId functionId; ///< Identity of the function or method, used for removal
+        Callback callback;   ///< Callable that wraps the actual function/method
+        std::uint32_t id;    ///< Identifier used as the connection index
+    };
+
+    /// Immutable list of listeners, published to the readers
+    using Snapshot = std::vector<Listener>;
+
+    /// Snapshot read by Trigger, nullptr when there is no listener
+    std::atomic<const Snapshot*> _snapshot{ nullptr };
+
+    /// Serializes the mutators
+    mutable std::mutex _mutex;
+
+    /// Unpublished snapshots with the epoch they were retired at
+    std::vector<std::pair<const Snapshot*, std::uint64_t>> _retired;
+
+    /// Scoped connections owning listeners, by listener id
+    std::vector<std::pair<std::uint32_t, ScopedConnection*>> _scoped;
+
+    std::uint32_t _nextId = 0;
+
+    static event_detail::EpochDomain& Domain() {
+        return event_detail::EpochDomain::Instance();
+    }
+
+    /// Copy of the current listeners, to be called with the mutex held.
+    Snapshot Copy() const {
+        const Snapshot* current = _snapshot.load(std::memory_order_relaxed);
+        return current != nullptr ? *current : Snapshot();
+    }
+
+    /// Publish a new listener list and reclaim old snapshots, to be called with the mutex held.
+    void Publish(Snapshot listeners) {
+        const Snapshot* next = listeners.empty() ? nullptr : new Snapshot(std::move(listeners));
+        const Snapshot* previous = _snapshot.exchange(next, std::memory_order_seq_cst);
+        if (previous != nullptr)
+            _retired.push_back({ previous, Domain().Advance() });
+
+        std::uint64_t oldest = Domain().OldestReader();
+        _retired.erase(std::remove_if(_retired.begin(), _retired.end(),
+            [oldest](const std::pair<const Snapshot*, std::uint64_t>& retired) {
+                if (retired.second >= oldest)
+                    return false;
+                delete retired.first;
+                return true;
+            }), _retired.end());
+    }
+
+    Connection Add(void* instancePtr, event_detail::FunctionId functionId, Callback callback) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        Snapshot listeners = Copy();
+        std::uint32_t id = _nextId++;
+        listeners.push_back({ instancePtr, functionId, callback, id });
+        Publish(std::move(listeners));
+        return { this, id, 0 };
+    }
+
+    /// Remove the listeners matching a predicate, to be called with the mutex held.
+    template <typename Predicate>
+    bool RemoveIf(Predicate predicate) {
+        Snapshot listeners = Copy();
+        auto removed = std::stable_partition(listeners.begin(), listeners.end(),
+            [&predicate](const Listener& listener) { return !predicate(listener); });
+        if (removed == listeners.end())
+            return false;
+
+        for (auto it = removed; it != listeners.end(); ++it)
+            DetachScoped(it->id);
+        listeners.erase(removed, listeners.end());
+        Publish(std::move(listeners));
+        return true;
+    }
+
+    void RemoveMatching(void* instancePtr, event_detail::FunctionId functionId) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        RemoveIf([instancePtr, functionId](const Listener& listener) {
+            return listener.instancePtr == instancePtr && listener.functionId == functionId;
+        });
+    }
+
+    void DetachScoped(std::uint32_t id) {
+        for (std::size_t i = 0; i < _scoped.size(); ++i) {
+            if (_scoped[i].first == id) {
+                Detach(_scoped[i].second);
+                _scoped[i] = _scoped.back();
+                _scoped.pop_back();
+                return;
+            }
+        }
+    }
+
+    bool IsConnectedLocked(std::uint32_t id) const {
+        const Snapshot* current = _snapshot.load(std::memory_order_relaxed);
+        return current != nullptr && std::any_of(current->begin(), current->end(),
+            [id](const Listener& listener) { return listener.id == id; });
+    }
+
+    /// @copydoc ConnectionOwner::Disconnect
+    bool Disconnect(std::uint32_t index, std::uint32_t) override {
+        return RemoveListener({ this, index, 0 });
+    }
+
+    /// @copydoc ConnectionOwner::Bind
+    bool Bind(std::uint32_t index, std::uint32_t, ScopedConnection* scoped) override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!IsConnectedLocked(index))
+            return false;
+        auto it = std::find_if(_scoped.begin(), _scoped.end(),
+            [index](const std::pair<std::uint32_t, ScopedConnection*>& entry) { return entry.first == index; });
+        if (scoped == nullptr) {
+            if (it != _scoped.end()) {
+                *it = _scoped.back();
+                _scoped.pop_back();
+            }
+            return true;
+        }
+        if (it != _scoped.end())
+            return false;
+        _scoped.push_back({ index, scoped });
+        return true;
+    }
+
+public:
+
+    ConcurrentEvent() = default;
+    ConcurrentEvent(const ConcurrentEvent&) = delete;
+    ConcurrentEvent& operator=(const ConcurrentEvent&) = delete;
+
+    /**
+     * @brief Destroy the event, no thread may be triggering it anymore.
+     */
+    ~ConcurrentEvent() {
+        for (const auto& entry : _scoped)
+            Detach(entry.second);
+        delete _snapshot.load(std::memory_order_relaxed);
+        for (const auto& retired : _retired)
+            delete retired.first;
+    }
+
+    /**
+     * @brief Add a free function with the exact signature void(Types...).
+     * @param function Pointer to the function to be added.
+     * @return Connection identifying the listener.
+     */
+    Connection AddListener(void(*function)(Types...)) {
+        return Add(nullptr, event_detail::FunctionId::Of(function), Callback::FromFunction(function));
+    }
+
+    /**
+     * @brief Add a free function with no parameters, ignoring the passed arguments.
+     * @param function Pointer to a function void().
+     * @return Connection identifying the listener.
+     */
+    Connection AddListener(event_detail::IgnoringFunction<Types...> function) {
+        return Add(nullptr, event_detail::FunctionId::Of(function), Callback::FromFunction(function)); // arguments ignored
+    }
+
+    /**
+     * @brief Remove a free function with signature void(Types...).
+     * @param function Pointer to the function to be removed.
+     */
+    void RemoveListener(void(*function)(Types...)) {
+        RemoveMatching(nullptr, event_detail::FunctionId::Of(function));
+    }
+
+    /**
+     * @brief Remove a free function with signature void().
+     * @param function Pointer to the function to be removed.
+     */
+    void RemoveListener(event_detail::IgnoringFunction<Types...> function) {
+        RemoveMatching(nullptr, event_detail::FunctionId::Of(function));
+    }
+
+    /**
+     * @brief Add a free function taking the arguments as Trigger passes them, e.g. const std::string&
+     * for a std::string argument, so that no copy is made for it.
+     * @param function Pointer to the function to be added.
+     * @return Connection identifying the listener.
+     */
+    Connection AddListener(event_detail::ParamFunction<Types...> function) {
+        return Add(nullptr, event_detail::FunctionId::Of(function), Callback::FromFunction(function));
+    }
+
+    /**
+     * @brief Remove a free function taking the arguments as Trigger passes them.
+     * @param function Pointer to the function to be removed.
+     */
+    void RemoveListener(event_detail::ParamFunction<Types...> function) {
+        RemoveMatching(nullptr, event_detail::FunctionId::Of(function));
+    }
+
+    /**
+     * @brief Add a member function with parameters.
+     *
+     * @tparam T Class type of the instance.
+     * @param instance Pointer to the object.
+     * @param function Pointer to the member method void(T::*)(Types...).
+     * @return Connection identifying the listener.
+     */
+    template <typename T>
+    Connection AddListener(T* instance, void(T::* function)(Types...)) {
+        return Add(instance, event_detail::FunctionId::Of(function), Callback::FromMethod(instance, function));
+    }
+
+    /**
+     * @brief Add a member function with no parameters, arguments are ignored.
+     *
+     * @tparam T Class type of the instance.
+     * @param instance Pointer to the object.
+     * @param function Pointer to the method void(T::*)().
+     * @return Connection identifying the listener.
+     */
+    template <typename T>
+    Connection AddListener(T* instance, event_detail::IgnoringMethod<T, Types...> function) {
+        return Add(instance, event_detail::FunctionId::Of(function), Callback::FromMethod(instance, function)); // arguments ignored
+    }
+
+    /**
+     * @brief Remove a member method with parameters.
+     *
+     * @tparam T Class type of the instance.
+     * @param instance Pointer to the object.
+     * @param function Pointer to the method void(T::*)(Types...).
+     */
+    template <typename T>
+    void RemoveListener(T* instance, void(T::* function)(Types...)) {
+        RemoveMatching(instance, event_detail::FunctionId::Of(function));
+    }
+
+    /**
+     * @brief Remove a member method with no parameters.
+     *
+     * @tparam T Class type of the instance.
+     * @param instance Pointer to the object.
+     * @param function Pointer to the method void(T::*)().
+     */
+    template <typename T>
+    void RemoveListener(T* instance, event_detail::IgnoringMethod<T, Types...> function) {
+        RemoveMatching(instance, event_detail::FunctionId::Of(function));
+    }
+
+    /**
+     * @brief Add a member function taking the arguments as Trigger passes them.
+     *
+     * @tparam T Class type of the instance.
+     * @param instance Pointer to the object.
+     * @param function Pointer to the member method void(T::*)(Param<Types>...).
+     * @return Connection identifying the listener.
+     */
+    template <typename T>
+    Connection AddListener(T* instance, event_detail::ParamMethod<T, Types...> function) {
+        return Add(instance, event_detail::FunctionId::Of(function), Callback::FromMethod(instance, function));
+    }
+
+    /**
+     * @brief Remove a member method taking the arguments as Trigger passes them.
+     *
+     * @tparam T Class type of the instance.
+     * @param instance Pointer to the object.
+     * @param function Pointer to the method void(T::*)(Param<Types>...).
+     */
+    template <typename T>
+    void RemoveListener(T* instance, event_detail::ParamMethod<T, Types...> function) {
+        RemoveMatching(instance, event_detail::FunctionId::Of(function));
+    }
+
+    /**
+     * @brief Remove the listener identified by a connection.
+     * @param connection Connection returned by AddListener.
+     * @return false if the connection was stale or invalid.
+     */
+    bool RemoveListener(Connection connection) {
+        if (connection.owner != this)
+            return false;
+        std::lock_guard<std::mutex> lock(_mutex);
+        return RemoveIf([&connection](const Listener& listener) { return listener.id == connection.index; });
+    }
+
+    /**
+     * @brief Check whether the listener identified by a connection is still registered.
+     * @param connection Connection returned by AddListener.
+     */
+    bool IsConnected(Connection connection) const {
+        if (connection.owner != this)
+            return false;
+        std::lock_guard<std::mutex> lock(_mutex);
+        return IsConnectedLocked(connection.index);
+    }
+
+    /**
+     * @brief Removes all registered listeners.
+     */
+    void RemoveAllListeners() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (const auto& entry : _scoped)
+            Detach(entry.second);
+        _scoped.clear();
+        Publish(Snapshot());
+    }
+
+    /**
+     * @brief Wait until every Trigger call started before this call has returned.
+     *
+     * Dispatches running on the calling thread are not waited for, so this can be called from a listener.
+     */
+    void Synchronize() const {
+        Domain().Synchronize();
+    }
+
+    /**
+     * @brief Trigger the event without locking, invoking the listeners registered when the call started.
+     *
+     * Arguments are passed to the listeners as with Event::Trigger.
+     * @param args Arguments to forward to the listeners.
+     */
+    void Trigger(event_detail::Param<Types>... args) const {
+        event_detail::EpochDomain::ReadGuard guard(Domain());
+        const Snapshot* listeners = _snapshot.load(std::memory_order_seq_cst);
+        if (listeners == nullptr)
+            return;
+        for (const auto& listener : *listeners)
+            listener.callback(args...);
+    }
+};
@@ -0,0 +1,231 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * @file Connection.h
+ * @brief Handles returned when a listener is added to an event.
+ *
+ * A Connection is a plain handle that can be used to remove its listener in O(1).
+ * A ScopedConnection owns a connection and removes the listener when destroyed, and a
+ * ConnectionGroup does the same for many connections at once.
+ */
+
+class ScopedConnection;
+
+namespace event_detail {
+
+    /**
+     * @brief Interface of the events connections point to.
+     *
+     * An owner keeps a back pointer to the ScopedConnection owning each of its listeners (if any),
+     * so that the scoped connection is detached when its listener is removed or the owner destroyed.
+     */
+    class ConnectionOwner {
+    public:
+        /**
+         * @brief Remove the listener identified by a slot index and generation.
+         * @return false if the listener was already removed.
+         */
+        virtual bool Disconnect(std::uint32_t index, std::uint32_t generation) = 0;
+
+        /**
+         * @brief Register the scoped connection owning a listener (nullptr to unregister it).
+         * @return false if the listener was removed or is already owned by another scoped connection.
+         */
+        virtual bool Bind(std::uint32_t index, std::uint32_t generation, ScopedConnection* scoped) = 0;
+
+    protected:
+        ~ConnectionOwner() = default;
+
+        /// Forget the listener owned by a scoped connection, without removing it.
+        static void Detach(ScopedConnection* scoped);
+
+        /// Point a scoped connection to its owner after the owner moved.
+        static void Retarget(ScopedConnection* scoped, ConnectionOwner* owner);
+    };
+
+}
+
+/**
+ * @brief Lightweight handle identifying a listener registered on an event.
+ *
+ * A connection stays valid until its listener is removed. Once removed, the slot generation
+ * changes and the handle is detected as stale, even if the slot is reused by another listener.
+ */
+struct Connection {
+    static constexpr std::uint32_t InvalidIndex = UINT32_MAX;
+
+    event_detail::ConnectionOwner* owner = nullptr; ///< Event the listener was added to
+    std::uint32_t index = InvalidIndex;             ///< Slot of the listener in the event slot map
+    std::uint32_t generation = 0;                   ///< Generation of the slot when the listener was added
+
+    /**
+     * @brief Remove the listener from its event in O(1).
+     *
+     * The event must still be alive and must not have been moved since the listener was added.
+     * @return false if the connection was stale or invalid.
+     */
+    bool Disconnect() const {
+        return owner != nullptr && owner->Disconnect(index, generation);
+    }
+
+    friend bool operator==(const Connection& a, const Connection& b) {
+        return a.owner == b.owner && a.index == b.index && a.generation == b.generation;
+    }
+
+    friend bool operator!=(const Connection& a, const Connection& b) {
+        return !(a == b);
+    }
+};
+
+/**
+ * @brief Move-only owner of a connection, removing the listener when destroyed.
+ *
+ * The event keeps a back pointer to the scoped connection instead of sharing a reference-counted
+ * state with it: destroying the event or removing the listener by other means simply empties the
+ * scoped connection, and destroying the scoped connection removes the listener in O(1).
+ * Only one scoped connection can own a given listener.
+ *
+ * Typical use is a member of the object whose method is registered, so the listener can never
+ * outlive the object:
+ * @code
+ * _onDamage = damageEvent.AddListener(this, &Player::OnDamage);
+ * @endcode
+ */
+class ScopedConnection {
+    friend class event_detail::ConnectionOwner;
+
+    Connection _connection;
+
+    void Own(Connection connection) {
+        if (connection.owner != nullptr && connection.owner->Bind(connection.index, connection.generation, this))
+            _connection = connection;
+    }
+
+public:
+
+    /// Create an empty scoped connection.
+    ScopedConnection() = default;
+
+    /**
+     * @brief Take ownership of a connection, usually the one returned by AddListener.
+     *
+     * The scoped connection stays empty if the listener was already removed or already owned.
+     * @param connection Connection to own.
+     */
+    ScopedConnection(Connection connection) {
+        Own(connection);
+    }
+
+    ScopedConnection(ScopedConnection&& other) noexcept {
+        Own(other.Release());
+    }
+
+    ScopedConnection& operator=(ScopedConnection&& other) noexcept {
+        if (this != &other) {
+            Disconnect();
+            Own(other.Release());
+        }
+        return *this;
+    }
+
+    ScopedConnection(const ScopedConnection&) = delete;
+    ScopedConnection& operator=(const ScopedConnection&) = delete;
+
+    ~ScopedConnection() {
+        Disconnect();
+    }
+
+    /**
+     * @brief Remove the listener now and empty the scoped connection.
+     */
+    void Disconnect() {
+        if (_connection.owner != nullptr) {
+            Connection connection = _connection;
+            _connection = Connection();
+            connection.owner->Disconnect(connection.index, connection.generation);
+        }
+    }
+
+    /**
+     * @brief Give up ownership without removing the listener.
+     * @return The connection that was owned.
+     */
+    Connection Release() {
+        Connection connection = _connection;
+        if (connection.owner != nullptr)
+            connection.owner->Bind(connection.index, connection.generation, nullptr);
+        _connection = Connection();
+        return connection;
+    }
+
+    /// @return true if the scoped connection still owns a registered listener.
+    bool IsConnected() const {
+        return _connection.owner != nullptr;
+    }
+
+    /// @return The owned connection, invalid if the scoped connection is empty.
+    const Connection& Get() const {
+        return _connection;
+    }
+};
+
+/**
+ * @brief Move-only set of scoped connections, removing all their listeners when destroyed.
+ */
+class ConnectionGroup {
+    std::vector<ScopedConnection> _connections;
+
+public:
+
+    ConnectionGroup() = default;
+    ConnectionGroup(ConnectionGroup&&) noexcept = default;
+    ConnectionGroup& operator=(ConnectionGroup&& other) noexcept {
+        if (this != &other) {
+            DisconnectAll();
+            _connections = std::move(other._connections);
+        }
+        return *this;
+    }
+
+    ~ConnectionGroup() {
+        DisconnectAll();
+    }
+
+    /**
+     * @brief Take ownership of a connection.
+     * @param connection Connection to own, usually the one returned by AddListener.
+     */
+    void Add(Connection connection) {
+        _connections.emplace_back(connection);
+    }
+
+    /// @copydoc Add
+    ConnectionGroup& operator+=(Connection connection) {
+        Add(connection);
+        return *this;
+    }
+
+    /**
+     * @brief Remove every listener owned by the group.
+     */
+    void DisconnectAll() {
+        _connections.clear();
+    }
+
+    /// @return Number of connections owned, including the ones whose listener was removed since.
+    std::size_t Size() const {
+        return _connections.size();
+    }
+};
+
+inline void event_detail::ConnectionOwner::Detach(ScopedConnection* scoped) {
+    scoped->_connection = Connection();
+}
+
+inline void event_detail::ConnectionOwner::Retarget(ScopedConnection* scoped, ConnectionOwner* owner) {
+    scoped->_connection.owner = owner;
+}
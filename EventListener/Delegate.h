@@ -0,0 +1,278 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @file Delegate.h
+ * @brief Fixed-size, non-allocating callable used to store event listeners.
+ *
+ * A Delegate is an object pointer plus a thunk, with inline storage large enough to hold any
+ * member function pointer. Unlike std::function it never allocates, is trivially copyable and
+ * calls its target through a single indirect call.
+ */
+
+namespace event_detail {
+
+    /// Never defined: member pointers to an incomplete class use the widest representation of the ABI.
+    class UnknownClass;
+
+    /// Member function pointer type used to size the inline storage of a Delegate.
+    using LargestMemberPointer = void (UnknownClass::*)();
+
+    /**
+     * @brief Exact identity of a free function or member function pointer, used to find listeners.
+     *
+     * A member function pointer is wider than a data pointer: on the Itanium ABI it holds the
+     * function address, or the vtable offset of a virtual method, plus a this adjustment, so its
+     * first word alone confuses virtual methods and methods of different bases. The identity keeps
+     * every word of the pointer. Their number is a compile-time constant (two on the Itanium ABI), so
+     * comparing identities is a couple of integer comparisons.
+     */
+    class FunctionId {
+        static constexpr std::size_t Words = (sizeof(LargestMemberPointer) + sizeof(std::uintptr_t) - 1) / sizeof(std::uintptr_t);
+
+        std::uintptr_t _words[Words] = {};
+
+    public:
+
+        /**
+         * @brief Identity of a function or member function pointer.
+         * @param pointer Pointer to a free function or a member function.
+         */
+        template <typename Pointer>
+        static FunctionId Of(Pointer pointer) {
+            static_assert(std::is_member_function_pointer<Pointer>::value
+                || (std::is_pointer<Pointer>::value && std::is_function<std::remove_pointer_t<Pointer>>::value),
+                "Only function and member function pointers have a FunctionId");
+            static_assert(sizeof(Pointer) <= sizeof(_words), "Pointer does not fit in a FunctionId");
+            FunctionId id;
+            std::memcpy(id._words, &pointer, sizeof(Pointer));
+            return id;
+        }
+
+        /// @return First word of the pointer: the function address, or a vtable offset for a virtual method.
+        void* Address() const {
+            return reinterpret_cast<void*>(_words[0]);
+        }
+
+        /// @return Hash of the whole pointer.
+        std::uint64_t Hash() const {
+            std::uint64_t hash = 0;
+            for (std::size_t i = 0; i < Words; ++i)
+                hash = (hash ^ static_cast<std::uint64_t>(_words[i])) * 0x9E3779B97F4A7C15ull;
+            return hash;
+        }
+
+        friend bool operator==(const FunctionId& a, const FunctionId& b) {
+            for (std::size_t i = 0; i < Words; ++i) {
+                if (a._words[i] != b._words[i])
+                    return false;
+            }
+            return true;
+        }
+
+        friend bool operator!=(const FunctionId& a, const FunctionId& b) {
+            return !(a == b);
+        }
+    };
+
+    /**
+     * @brief Type used to pass an event argument of type T to the listeners.
+     *
+     * References and small trivially copyable types are passed as is, anything else by const
+     * reference so that dispatching to many listeners does not copy the argument for each of them.
+     */
+    template <typename T>
+    using Param = std::conditional_t<std::is_reference<T>::value
+        || (std::is_trivially_copyable<T>::value && sizeof(T) <= 2 * sizeof(void*)), T, const T&>;
+
+    template <bool SameArity, typename Params, typename Args>
+    struct AcceptsSameArity : std::false_type {};
+
+    template <typename... Params, typename... Args>
+    struct AcceptsSameArity<true, void(Params...), void(Args...)>
+        : std::bool_constant<(std::is_constructible<Params, Args>::value && ...)> {};
+
+    /// Whether a target taking Params... can be called with Args... (or takes no argument).
+    template <typename Params, typename Args>
+    struct AcceptsArguments;
+
+    template <typename... Params, typename... Args>
+    struct AcceptsArguments<void(Params...), void(Args...)>
+        : AcceptsSameArity<sizeof...(Params) == sizeof...(Args), void(Params...), void(Args...)> {};
+
+    template <typename... Args>
+    struct AcceptsArguments<void(), void(Args...)> : std::true_type {};
+
+    /// Never defined: used so that an overload vanishes when its signature would duplicate another one.
+    template <int Tag>
+    struct NoOverload;
+
+    /// void() function pointer, or a pointer to an undefined type when the event takes no argument.
+    template <typename... Types>
+    using IgnoringFunction = std::conditional_t<sizeof...(Types) == 0, NoOverload<0>*, void(*)()>;
+
+    /// void(T::*)() member pointer, or a pointer to an undefined type when the event takes no argument.
+    template <typename T, typename... Types>
+    using IgnoringMethod = std::conditional_t<sizeof...(Types) == 0, NoOverload<0>*, void(T::*)()>;
+
+    /// Function taking the arguments as passed by Trigger, or a pointer to an undefined type if that is void(Types...).
+    template <typename... Types>
+    using ParamFunction = std::conditional_t<std::is_same<void(Param<Types>...), void(Types...)>::value,
+        NoOverload<1>*, void(*)(Param<Types>...)>;
+
+    /// Method taking the arguments as passed by Trigger, or a pointer to an undefined type if that is void(Types...).
+    template <typename T, typename... Types>
+    using ParamMethod = std::conditional_t<std::is_same<void(Param<Types>...), void(Types...)>::value,
+        NoOverload<1>*, void(T::*)(Param<Types>...)>;
+
+    /**
+     * @brief Pass an argument received by a delegate to a target parameter of type Param.
+     *
+     * When the argument is a const reference to an object the target takes by value, and the caller
+     * allowed it with release, the argument is moved from instead of copied. The caller guarantees
+     * the referenced object is not const in that case.
+     */
+    template <typename Param, typename Arg>
+    decltype(auto) PassArgument(Arg&& arg, bool release) {
+        using Value = std::remove_cv_t<std::remove_reference_t<Arg>>;
+        if constexpr (!std::is_reference<Param>::value && std::is_same<std::remove_cv_t<Param>, Value>::value
+            && std::is_same<Arg&&, const Value&>::value && !std::is_trivially_copyable<Value>::value) {
+            if (release)
+                return Value(std::move(const_cast<Value&>(arg)));
+            return Value(arg);
+        }
+        else {
+            (void)release;
+            return std::forward<Arg>(arg);
+        }
+    }
+
+}
+
+template <typename Signature>
+class Delegate;
+
+/**
+ * @brief Non-allocating callable wrapping a free function or a member method bound to an instance.
+ *
+ * Targets may either take parameters constructible from the delegate arguments, or take no
+ * argument at all, in which case the arguments passed to the delegate are ignored.
+ *
+ * @tparam R Return type.
+ * @tparam Args Argument types of the delegate.
+ */
+template <typename R, typename... Args>
+class Delegate<R(Args...)> {
+
+    /// Function generated for each kind of target, restoring the stored pointers and calling it
+    using Thunk = R(*)(const Delegate&, bool release, Args...);
+
+    Thunk _thunk = nullptr;   ///< Invocation thunk, nullptr for an empty delegate
+    void* _object = nullptr;  ///< Bound instance (nullptr for free functions)
+    alignas(event_detail::LargestMemberPointer)
+    unsigned char _storage[sizeof(event_detail::LargestMemberPointer)] = {}; ///< Function or method pointer
+
+    template <typename Pointer>
+    void Store(Pointer pointer) {
+        static_assert(sizeof(Pointer) <= sizeof(_storage), "Pointer does not fit in the delegate storage");
+        std::memcpy(_storage, &pointer, sizeof(Pointer));
+    }
+
+    template <typename Pointer>
+    Pointer Load() const {
+        Pointer pointer;
+        std::memcpy(&pointer, _storage, sizeof(Pointer));
+        return pointer;
+    }
+
+    template <typename... Params>
+    static constexpr bool IsAccepted() {
+        return event_detail::AcceptsArguments<void(Params...), void(Args...)>::value;
+    }
+
+    template <typename... Params>
+    static R CallFunction(const Delegate& self, bool release, Args... args) {
+        auto function = self.Load<R(*)(Params...)>();
+        if constexpr (sizeof...(Params) == 0) {
+            ((void)release, ..., (void)args); // arguments ignored
+            return function();
+        }
+        else
+            return function(event_detail::PassArgument<Params>(std::forward<Args>(args), release)...);
+    }
+
+    template <typename T, typename... Params>
+    static R CallMethod(const Delegate& self, bool release, Args... args) {
+        auto method = self.Load<R(T::*)(Params...)>();
+        T* instance = static_cast<T*>(self._object);
+        if constexpr (sizeof...(Params) == 0) {
+            ((void)release, ..., (void)args); // arguments ignored
+            return (instance->*method)();
+        }
+        else
+            return (instance->*method)(event_detail::PassArgument<Params>(std::forward<Args>(args), release)...);
+    }
+
+public:
+
+    /// Create an empty delegate, which must not be called.
+    Delegate() = default;
+
+    /**
+     * @brief Bind a free function taking either arguments constructible from the delegate ones, or no argument.
+     * @param function Pointer to the function.
+     */
+    template <typename... Params>
+    static Delegate FromFunction(R(*function)(Params...)) {
+        static_assert(IsAccepted<Params...>(), "Function must take arguments constructible from the delegate ones, or no argument");
+        Delegate delegate;
+        delegate._thunk = &CallFunction<Params...>;
+        delegate.Store(function);
+        return delegate;
+    }
+
+    /**
+     * @brief Bind a member method taking either arguments constructible from the delegate ones, or no argument.
+     *
+     * @tparam T Class type of the instance.
+     * @param instance Pointer to the object, which must outlive the delegate.
+     * @param method Pointer to the member method.
+     */
+    template <typename T, typename... Params>
+    static Delegate FromMethod(T* instance, R(T::* method)(Params...)) {
+        static_assert(IsAccepted<Params...>(), "Method must take arguments constructible from the delegate ones, or no argument");
+        Delegate delegate;
+        delegate._thunk = &CallMethod<T, Params...>;
+        delegate._object = instance;
+        delegate.Store(method);
+        return delegate;
+    }
+
+    /// @return true if the delegate is bound to a target.
+    explicit operator bool() const {
+        return _thunk != nullptr;
+    }
+
+    /**
+     * @brief Call the bound target.
+     * @param args Arguments forwarded to the target.
+     */
+    R operator()(Args... args) const {
+        return _thunk(*this, false, std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Call the bound target, letting it move from the arguments passed by const reference.
+     *
+     * Only arguments the target takes by value are moved from. The caller must own the referenced
+     * objects, which must not be const objects.
+     * @param args Arguments forwarded to the target.
+     */
+    R CallAndRelease(Args... args) const {
+        return _thunk(*this, true, std::forward<Args>(args)...);
+    }
+};
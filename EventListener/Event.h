@@ -1,6 +1,13 @@
 #pragma once
-#include <vector>
-#include <functional>
+#include <cstddef>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
+#include "Delegate.h"
+#include "ListenerList.h"
 
 /**
  * @file Event.h
@@ -18,51 +25,75 @@
   * triggered with arguments of specified types. It supports:
   * - Free functions with or without parameters.
   * - Member methods with or without parameters.
-  * 
-  * It does not allow automatic deletion of object methods.
-  * So you must remove the method from the listeners before destroying the object.
   *
+  * Listeners are called by decreasing priority (0 by default), and in insertion order for equal priorities.
+  *
+  * Each AddListener overload returns a Connection which removes the listener in O(1).
+  * Listeners can also be removed by function (and instance), which scans all the listeners.
+  *
+  * Listeners may add and remove listeners while the event is triggered: removed listeners are not
+  * called anymore, added ones are called from the next Trigger on.
+  *
+  * An event is not thread-safe, even through a const reference: Trigger is const so that listeners
+  * can be notified through read-only access, but it updates the dispatch state of the event, so an
+  * event must not be triggered from several threads at once. Use ConcurrentEvent for that.
+  *
+  * Object methods are not removed automatically when the object is destroyed.
+  * Either remove the method from the listeners before destroying the object, keep the
+  * returned connection in a ScopedConnection (or ConnectionGroup) owned by the object, or add it
+  * as a weak listener, with a std::shared_ptr to the object or a LifetimeToken it owns.
+  *
+  * The listener storage comes from Allocator (rebound to the internal types). Listeners never
+  * allocate themselves, so with an arena allocator an event makes no other heap allocation, except
+  * for TriggerParallelDetached, whose snapshot of the listeners outlives the call and the event.
+  * The first InlineCapacity listeners are stored in the event itself, and only more listeners
+  * allocate. Event uses the default allocator, PmrEvent a std::pmr memory resource, and SmallEvent
+  * stores a few listeners inline.
+  *
+  * @tparam Allocator Allocator of the listener storage.
+  * @tparam InlineCapacity Number of listeners stored in the event itself.
   * @tparam Types Variadic template representing the argument types passed to the listeners.
   */
-template <typename... Types>
-class Event {
+template <typename Allocator, std::size_t InlineCapacity, typename... Types>
+class BasicEvent : public event_detail::ListenerList<Delegate<void(event_detail::Param<Types>...)>, Allocator, InlineCapacity> {
 
-    /// Internal function wrapper type matching the event signature
-    using Callback = std::function<void(Types...)>;
+    /// Internal non-allocating function wrapper type, receiving the arguments as passed by Trigger
+    using Callback = Delegate<void(event_detail::Param<Types>...)>;
 
-    /**
-     * @brief Internal representation of a registered listener.
-     */
-    struct Listener {
-        void* instancePtr;   ///< Pointer to the object instance (or nullptr for free functions)
-        void* functionPtr;   ///< Raw pointer used for comparison and removal
-        Callback callback;   ///< Callable that wraps the actual function/method
-    };
-
-    /// List of listenners
-    std::vector<Listener> _listeners;
+    using Base = event_detail::ListenerList<Callback, Allocator, InlineCapacity>;
 
 public:
 
+    using Base::AddListener;
+    using Base::RemoveListener;
+
+    BasicEvent() = default;
+
+    /**
+     * @brief Create an event whose listener storage comes from an allocator.
+     * @param allocator Allocator of the listener storage.
+     */
+    explicit BasicEvent(const Allocator& allocator) : Base(allocator) {}
+
     /**
      * @brief Add a free function with the exact signature void(Types...).
      * @param function Pointer to the function to be added.
+     * @param priority Listeners with a higher priority are called first, equal ones in insertion order.
+     * @return Connection identifying the listener.
      */
-    void AddListener(void(*function)(Types...)) {
-        _listeners.push_back({ nullptr, reinterpret_cast<void*>(function), function });
+    Connection AddListener(void(*function)(Types...), int priority = 0) {
+        return this->Add(nullptr, event_detail::FunctionId::Of(function), Callback::FromFunction(function), priority);
     }
 
     /**
      * @brief Add a free function with no parameters, ignoring the passed arguments.
      *
      * @param function Pointer to a function void().
+     * @param priority Listeners with a higher priority are called first, equal ones in insertion order.
+     * @return Connection identifying the listener.
      */
-    void AddListener(void(*function)()) {
-        _listeners.push_back({ nullptr, reinterpret_cast<void*>(function),
-            [function](Types...) {
-                function(); // arguments ignored
-            }
-            });
+    Connection AddListener(void(*function)(), int priority = 0) {
+        return this->Add(nullptr, event_detail::FunctionId::Of(function), Callback::FromFunction(function), priority); // arguments ignored
     }
 
     /**
@@ -70,11 +101,7 @@ public:
      * @param function Pointer to the function to be removed.
      */
     void RemoveListener(void(*function)(Types...)) {
-        void* functionPtr = reinterpret_cast<void*>(function);
-        _listeners.erase(std::remove_if(_listeners.begin(), _listeners.end(),
-            [functionPtr](const Listener& listener) {
-                return listener.functionPtr == functionPtr;
-            }), _listeners.end());
+        this->RemoveMatching(nullptr, event_detail::FunctionId::Of(function));
     }
 
     /**
@@ -82,11 +109,26 @@ public:
      * @param function Pointer to the function to be removed.
      */
     void RemoveListener(void(*function)()) {
-        void* functionPtr = reinterpret_cast<void*>(function);
-        _listeners.erase(std::remove_if(_listeners.begin(), _listeners.end(),
-            [functionPtr](const Listener& listener) {
-                return listener.functionPtr == functionPtr;
-            }), _listeners.end());
+        this->RemoveMatching(nullptr, event_detail::FunctionId::Of(function));
+    }
+
+    /**
+     * @brief Add a free function taking the arguments as Trigger passes them, e.g. const std::string&
+     * for a std::string argument, so that no copy is made for it.
+     * @param function Pointer to the function to be added.
+     * @param priority Listeners with a higher priority are called first, equal ones in insertion order.
+     * @return Connection identifying the listener.
+     */
+    Connection AddListener(event_detail::ParamFunction<Types...> function, int priority = 0) {
+        return this->Add(nullptr, event_detail::FunctionId::Of(function), Callback::FromFunction(function), priority);
+    }
+
+    /**
+     * @brief Remove a free function taking the arguments as Trigger passes them.
+     * @param function Pointer to the function to be removed.
+     */
+    void RemoveListener(event_detail::ParamFunction<Types...> function) {
+        this->RemoveMatching(nullptr, event_detail::FunctionId::Of(function));
     }
 
     /**
@@ -95,14 +137,12 @@ public:
      * @tparam T Class type of the instance.
      * @param instance Pointer to the object.
      * @param function Pointer to the member method void(T::*)(Types...).
+     * @param priority Listeners with a higher priority are called first, equal ones in insertion order.
+     * @return Connection identifying the listener.
      */
     template<typename T>
-    void AddListener(T* instance, void(T::* function)(Types...)) {
-        _listeners.push_back({ instance, *reinterpret_cast<void**>(&function),
-            [instance, function](Types... args) {
-                (instance->*function)(args...);
-            }
-            });
+    Connection AddListener(T* instance, void(T::* function)(Types...), int priority = 0) {
+        return this->Add(instance, event_detail::FunctionId::Of(function), Callback::FromMethod(instance, function), priority);
     }
 
     /**
@@ -111,14 +151,12 @@ public:
      * @tparam T Class type of the instance.
      * @param instance Pointer to the object.
      * @param function Pointer to the method void(T::*)().
+     * @param priority Listeners with a higher priority are called first, equal ones in insertion order.
+     * @return Connection identifying the listener.
      */
     template <typename T>
-    void AddListener(T* instance, void(T::* function)()) {
-        _listeners.push_back({ instance, *reinterpret_cast<void**>(&function),
-            [instance, function](Types... args) {
-                (instance->*function)();
-            }
-            });
+    Connection AddListener(T* instance, void(T::* function)(), int priority = 0) {
+        return this->Add(instance, event_detail::FunctionId::Of(function), Callback::FromMethod(instance, function), priority); // arguments ignored
     }
 
     /**
@@ -130,11 +168,7 @@ public:
      */
     template <typename T>
     void RemoveListener(T* instance, void(T::* function)(Types...)) {
-        void* functionPtr = *reinterpret_cast<void**>(&function);
-        _listeners.erase(std::remove_if(_listeners.begin(), _listeners.end(),
-            [instance, functionPtr](const Listener& listener) {
-                return listener.instancePtr == instance && listener.functionPtr == functionPtr;
-            }), _listeners.end());
+        this->RemoveMatching(instance, event_detail::FunctionId::Of(function));
     }
 
     /**
@@ -146,56 +180,162 @@ public:
      */
     template <typename T>
     void RemoveListener(T* instance, void(T::* function)()) {
-        void* functionPtr = *reinterpret_cast<void**>(&function);
-        _listeners.erase(std::remove_if(_listeners.begin(), _listeners.end(),
-            [instance, functionPtr](const Listener& listener) {
-                return listener.instancePtr == instance && listener.functionPtr == functionPtr;
-            }), _listeners.end());
+        this->RemoveMatching(instance, event_detail::FunctionId::Of(function));
     }
 
     /**
-     * @brief Removes all registered listeners.
+     * @brief Add a member function taking the arguments as Trigger passes them.
+     *
+     * @tparam T Class type of the instance.
+     * @param instance Pointer to the object.
+     * @param function Pointer to the member method void(T::*)(Param<Types>...).
+     * @param priority Listeners with a higher priority are called first, equal ones in insertion order.
+     * @return Connection identifying the listener.
      */
-    void RemoveAllListeners() {
-        _listeners.clear();
+    template <typename T>
+    Connection AddListener(T* instance, event_detail::ParamMethod<T, Types...> function, int priority = 0) {
+        return this->Add(instance, event_detail::FunctionId::Of(function), Callback::FromMethod(instance, function), priority);
+    }
+
+    /**
+     * @brief Remove a member method taking the arguments as Trigger passes them.
+     *
+     * @tparam T Class type of the instance.
+     * @param instance Pointer to the object.
+     * @param function Pointer to the method void(T::*)(Param<Types>...).
+     */
+    template <typename T>
+    void RemoveListener(T* instance, event_detail::ParamMethod<T, Types...> function) {
+        this->RemoveMatching(instance, event_detail::FunctionId::Of(function));
     }
 
     /**
      * @brief Trigger the event, invoking all registered callbacks.
+     *
+     * Arguments that are not small trivially copyable types are taken and passed to the listeners by
+     * const reference, so only the listeners taking them by value copy them.
+     * @param args Arguments to forward to the listeners.
+     */
+    void Trigger(event_detail::Param<Types>... args) const {
+        typename Base::DispatchGuard guard(*this);
+        for (std::size_t i = 0, count = this->CallbackCount(); i < count; ++i) {
+            if (this->IsLive(i))
+                this->Call(i, args...);
+        }
+    }
+
+    /**
+     * @brief Trigger the event, moving the arguments into the last listener.
+     *
+     * Behaves like Trigger, except that the arguments are owned by the call, so the last listener
+     * takes them by move instead of by copy when it takes them by value.
+     * @param args Arguments to forward to the listeners, usually moved in by the caller.
+     */
+    void TriggerMove(Types... args) const {
+        constexpr bool movable = ((!std::is_reference<Types>::value && !std::is_const<Types>::value) && ...);
+        typename Base::DispatchGuard guard(*this);
+        std::size_t last = this->CallbackCount();
+        while (last != 0 && !this->IsLive(last - 1))
+            --last;
+
+        for (std::size_t i = 0; i + 1 < last; ++i) {
+            if (this->IsLive(i))
+                this->Call(i, args...);
+        }
+        if (last != 0 && this->IsLive(last - 1)) {
+            typename Base::ListenerTimer timer(*this, last - 1);
+            if constexpr (movable)
+                this->Callbacks()[last - 1].CallAndRelease(args...);
+            else
+                this->Callbacks()[last - 1](args...);
+        }
+    }
+
+    /**
+     * @brief Trigger the event, running the parallel-safe listeners concurrently on an executor.
+     *
+     * The parallel-safe listeners are split in chunks run as separate tasks, while the other ones
+     * run in order as a single task. Returns once every listener was called. Listeners must not add
+     * or remove listeners of this event during the call.
+     *
+     * @tparam Executor Type providing ThreadCount(), Submit(task) and ParallelFor(count, function),
+     * such as WorkStealingPool.
+     * @param executor Executor running the tasks.
+     * @param args Arguments to forward to the listeners.
+     */
+    template <typename Executor>
+    void TriggerParallel(Executor& executor, event_detail::Param<Types>... args) const {
+        this->DispatchParallel(executor, [&](const Callback& callback) { callback(args...); });
+    }
+
+    /**
+     * @brief Trigger the event on an executor and return without waiting for the listeners.
+     *
+     * The listeners and the arguments are copied, so the event may change as soon as the call returns.
+     * The objects of member listeners must outlive the tasks, except for weak listeners: a task skips
+     * a weak listener whose object expired before the call, and keeps an object owned by a
+     * std::shared_ptr alive during the call. An object tracked by a LifetimeToken must still not be
+     * destroyed while its listener runs.
+     * @param executor Executor running the tasks.
      * @param args Arguments to forward to the listeners.
      */
-    void Trigger(Types... args) const {
-        for (const auto& listener : _listeners)
-            listener.callback(args...);
+    template <typename Executor>
+    void TriggerParallelDetached(Executor& executor, event_detail::Param<Types>... args) const {
+        this->DispatchParallelDetached(executor, [arguments = std::tuple<std::decay_t<Types>...>(args...)](const Callback& callback) {
+            std::apply(callback, arguments);
+        });
+    }
+
+    /**
+     * @brief Trigger the event once per argument tuple, listener by listener.
+     *
+     * Each listener is called with every tuple before the next listener is called, which keeps the
+     * listener code and data hot when the same event is dispatched many times.
+     * @param events Argument tuples, usually the content of an EventQueue.
+     * @param count Number of tuples.
+     */
+    void TriggerBatch(const std::tuple<std::decay_t<Types>...>* events, std::size_t count) const {
+        typename Base::DispatchGuard guard(*this);
+        for (std::size_t position = 0; position < this->CallbackCount(); ++position) {
+            for (std::size_t i = 0; i < count && this->IsLive(position); ++i)
+                std::apply([this, position](const auto&... args) { this->Call(position, args...); }, events[i]);
+        }
     }
 };
 
 /**
- * @brief Specialization of Event for events with no arguments (Event<>).
+ * @brief Specialization of BasicEvent for events with no arguments (Event<>).
  *
  * Simplifies the logic for functions and methods that do not take any parameters.
  * Necessary to avoid ambiguous overloads when Types... is empty.
  */
-template <>
-class Event<> {
-    using Callback = std::function<void()>;
+template <typename Allocator, std::size_t InlineCapacity>
+class BasicEvent<Allocator, InlineCapacity> : public event_detail::ListenerList<Delegate<void()>, Allocator, InlineCapacity> {
+    using Callback = Delegate<void()>;
 
+    using Base = event_detail::ListenerList<Callback, Allocator, InlineCapacity>;
 
-    struct Listener {
-        void* instancePtr;
-        void* functionPtr;
-        Callback callback;
-    };
+public:
 
-    std::vector<Listener> _listeners;
+    using Base::AddListener;
+    using Base::RemoveListener;
+
+    BasicEvent() = default;
+
+    /**
+     * @brief Create an event whose listener storage comes from an allocator.
+     * @param allocator Allocator of the listener storage.
+     */
+    explicit BasicEvent(const Allocator& allocator) : Base(allocator) {}
 
-public:
     /**
      * @brief Add a free function with no arguments.
      * @param function Pointer to the function.
+     * @param priority Listeners with a higher priority are called first, equal ones in insertion order.
+     * @return Connection identifying the listener.
      */
-    void AddListener(void(*function)()) {
-        _listeners.push_back({ nullptr, reinterpret_cast<void*>(function), function });
+    Connection AddListener(void(*function)(), int priority = 0) {
+        return this->Add(nullptr, event_detail::FunctionId::Of(function), Callback::FromFunction(function), priority);
     }
 
     /**
@@ -203,11 +343,7 @@ public:
      * @param function Pointer to the function.
      */
     void RemoveListener(void(*function)()) {
-        void* functionPtr = reinterpret_cast<void*>(function);
-        _listeners.erase(std::remove_if(_listeners.begin(), _listeners.end(),
-            [functionPtr](const Listener& listener) {
-                return listener.functionPtr == functionPtr;
-            }), _listeners.end());
+        this->RemoveMatching(nullptr, event_detail::FunctionId::Of(function));
     }
 
     /**
@@ -216,14 +352,12 @@ public:
      * @tparam T Class type.
      * @param instance Pointer to the object.
      * @param function Pointer to the method.
+     * @param priority Listeners with a higher priority are called first, equal ones in insertion order.
+     * @return Connection identifying the listener.
      */
     template <typename T>
-    void AddListener(T* instance, void(T::* function)()) {
-        _listeners.push_back({ instance, *reinterpret_cast<void**>(&function),
-            [instance, function]() {
-                (instance->*function)();
-            }
-            });
+    Connection AddListener(T* instance, void(T::* function)(), int priority = 0) {
+        return this->Add(instance, event_detail::FunctionId::Of(function), Callback::FromMethod(instance, function), priority);
     }
 
     /**
@@ -235,25 +369,102 @@ public:
      */
     template <typename T>
     void RemoveListener(T* instance, void(T::* function)()) {
-        void* functionPtr = *reinterpret_cast<void**>(&function);
-        _listeners.erase(std::remove_if(_listeners.begin(), _listeners.end(),
-            [instance, functionPtr](const Listener& listener) {
-                return listener.instancePtr == instance && listener.functionPtr == functionPtr;
-            }), _listeners.end());
+        this->RemoveMatching(instance, event_detail::FunctionId::Of(function));
     }
 
     /**
-     * @brief Remove all listeners.
+     * @brief Trigger the event, calling all listeners.
      */
-    void RemoveAllListeners() {
-        _listeners.clear();
+    void Trigger() const {
+        typename Base::DispatchGuard guard(*this);
+        for (std::size_t i = 0, count = this->CallbackCount(); i < count; ++i) {
+            if (this->IsLive(i))
+                this->Call(i);
+        }
     }
 
     /**
-     * @brief Trigger the event, calling all listeners.
+     * @brief Trigger the event, running the parallel-safe listeners concurrently on an executor.
+     *
+     * The parallel-safe listeners are split in chunks run as separate tasks, while the other ones
+     * run in order as a single task. Returns once every listener was called. Listeners must not add
+     * or remove listeners of this event during the call.
+     *
+     * @tparam Executor Type providing ThreadCount(), Submit(task) and ParallelFor(count, function),
+     * such as WorkStealingPool.
+     * @param executor Executor running the tasks.
      */
-    void Trigger() const {
-        for (const auto& l : _listeners)
-            l.callback();
+    template <typename Executor>
+    void TriggerParallel(Executor& executor) const {
+        this->DispatchParallel(executor, [&](const Callback& callback) { callback(); });
+    }
+
+    /**
+     * @brief Trigger the event on an executor and return without waiting for the listeners.
+     *
+     * The listeners and the arguments are copied, so the event may change as soon as the call returns.
+     * The objects of member listeners must outlive the tasks, except for weak listeners: a task skips
+     * a weak listener whose object expired before the call, and keeps an object owned by a
+     * std::shared_ptr alive during the call. An object tracked by a LifetimeToken must still not be
+     * destroyed while its listener runs.
+     * @param executor Executor running the tasks.
+     */
+    template <typename Executor>
+    void TriggerParallelDetached(Executor& executor) const {
+        this->DispatchParallelDetached(executor, [](const Callback& callback) { callback(); });
+    }
+
+    /**
+     * @brief Trigger the event count times, listener by listener.
+     * @param count Number of times each listener is called.
+     */
+    void TriggerBatch(const std::tuple<>*, std::size_t count) const {
+        typename Base::DispatchGuard guard(*this);
+        for (std::size_t position = 0; position < this->CallbackCount(); ++position) {
+            for (std::size_t i = 0; i < count && this->IsLive(position); ++i)
+                this->Call(position);
+        }
     }
 };
+
+/**
+ * @brief Event whose listener storage uses the default allocator, see BasicEvent.
+ *
+ * @tparam Types Variadic template representing the argument types passed to the listeners.
+ */
+template <typename... Types>
+class Event : public BasicEvent<std::allocator<std::byte>, 0, Types...> {
+public:
+    using BasicEvent<std::allocator<std::byte>, 0, Types...>::BasicEvent;
+};
+
+/**
+ * @brief Event storing its first N listeners in itself, and allocating only beyond that.
+ *
+ * Suited to events embedded in many objects and having zero to a few listeners each. Every
+ * inline listener adds 81 bytes to the 56 bytes of an Event on 64-bit targets, rounded up to a
+ * multiple of 8, so N should stay small.
+ * @code
+ * struct Component {
+ *     SmallEvent<2, float> onDamage;
+ * };
+ * @endcode
+ *
+ * @tparam N Number of listeners stored inline.
+ * @tparam Types Variadic template representing the argument types passed to the listeners.
+ */
+template <std::size_t N, typename... Types>
+using SmallEvent = BasicEvent<std::allocator<std::byte>, N, Types...>;
+
+#if __has_include(<memory_resource>)
+/**
+ * @brief Event whose listener storage comes from a std::pmr memory resource, such as a frame arena.
+ *
+ * @code
+ * std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer));
+ * PmrEvent<int> event(&arena);
+ * @endcode
+ */
+template <typename... Types>
+using PmrEvent = BasicEvent<std::pmr::polymorphic_allocator<std::byte>, 0, Types...>;
+#endif
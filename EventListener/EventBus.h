@@ -0,0 +1,136 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Event.h"
+
+/**
+ * @file EventBus.h
+ * @brief Bus routing events by type to one Event per event type.
+ */
+
+namespace event_detail {
+
+    /// @return Next free event type id, shared by every translation unit.
+    inline std::size_t NextEventTypeId() {
+        static std::atomic<std::size_t> next{ 0 };
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Dense id of an event type, assigned the first time the type is used by any bus.
+     */
+    template <typename T>
+    std::size_t EventTypeId() {
+        static const std::size_t id = NextEventTypeId();
+        return id;
+    }
+
+}
+
+/**
+ * @brief Publish/subscribe bus holding one Event<T> per event type T.
+ *
+ * Every event type gets a small process-wide integer id the first time it is used, so finding the
+ * event of a type is an array access, without hashing. Events are created on first subscription
+ * and keep their address for the lifetime of the bus, so connections stay valid when the bus is moved.
+ *
+ * Like Event, a bus is not thread-safe.
+ * @code
+ * EventBus bus;
+ * bus.Subscribe<Collision>(&physics, &Physics::OnCollision);
+ * bus.Publish(Collision{ a, b });
+ * @endcode
+ */
+class EventBus {
+
+    struct Channel {
+        virtual ~Channel() = default;
+    };
+
+    template <typename T>
+    struct TypedChannel : Channel {
+        Event<T> event;
+    };
+
+    /// Events indexed by event type id, nullptr for types without subscribers on this bus
+    std::vector<std::unique_ptr<Channel>> _channels;
+
+public:
+
+    EventBus() = default;
+    EventBus(EventBus&&) = default;
+    EventBus& operator=(EventBus&&) = default;
+
+    /**
+     * @brief Event of a type, created if needed.
+     * @tparam T Event type.
+     */
+    template <typename T>
+    Event<T>& EventOf() {
+        static_assert(std::is_same<T, std::decay_t<T>>::value, "Event types must not be references or const");
+        const std::size_t id = event_detail::EventTypeId<T>();
+        if (id >= _channels.size())
+            _channels.resize(id + 1);
+        if (!_channels[id])
+            _channels[id] = std::make_unique<TypedChannel<T>>();
+        return static_cast<TypedChannel<T>&>(*_channels[id]).event;
+    }
+
+    /**
+     * @brief Event of a type, if it was created.
+     * @tparam T Event type.
+     * @return nullptr if nothing subscribed to the type on this bus.
+     */
+    template <typename T>
+    const Event<T>* FindEvent() const {
+        const std::size_t id = event_detail::EventTypeId<T>();
+        if (id >= _channels.size() || !_channels[id])
+            return nullptr;
+        return &static_cast<const TypedChannel<T>&>(*_channels[id]).event;
+    }
+
+    /**
+     * @brief Add a listener to the event of a type, with any Event<T>::AddListener arguments.
+     * @tparam T Event type.
+     * @return Connection identifying the listener.
+     */
+    template <typename T, typename... Args>
+    Connection Subscribe(Args&&... args) {
+        return EventOf<T>().AddListener(std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Remove listeners from the event of a type, with any Event<T>::RemoveListener arguments.
+     * @tparam T Event type.
+     */
+    template <typename T, typename... Args>
+    void Unsubscribe(Args&&... args) {
+        if (FindEvent<T>() != nullptr)
+            EventOf<T>().RemoveListener(std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Trigger the event of the type of an event object.
+     * @param event Event object passed to the listeners.
+     */
+    template <typename T>
+    void Publish(const T& event) const {
+        if (const Event<T>* found = FindEvent<T>())
+            found->Trigger(event);
+    }
+
+    /**
+     * @brief Construct an event object and trigger the event of its type.
+     * @tparam T Event type.
+     * @param args Arguments of the T constructor.
+     */
+    template <typename T, typename... Args>
+    void Emplace(Args&&... args) const {
+        if (const Event<T>* found = FindEvent<T>())
+            found->Trigger(T(std::forward<Args>(args)...));
+    }
+};
@@ -0,0 +1,233 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "Event.h"
+#include "EventQueue.h"
+
+/**
+ * @file EventChannel.h
+ * @brief Bounded lock-free channels carrying events from producer threads to consumer threads.
+ *
+ * Producers post event arguments from any thread, and a consumer thread drains them into an
+ * Event, which only that thread triggers.
+ */
+
+/**
+ * @brief Number of threads allowed to consume a channel at the same time.
+ */
+enum class ChannelConsumers {
+    Single,   ///< One consumer thread at a time, cheaper to drain
+    Multiple, ///< Any number of consumer threads
+};
+
+/**
+ * @brief Bounded lock-free ring buffer of event arguments.
+ *
+ * Each cell of the ring holds one argument tuple and a sequence number telling whether the cell
+ * is ready to be written or read. Cells are padded to a cache line so that producers and consumers
+ * working on neighbouring cells do not share lines. Producers claim cells with a CAS on the
+ * enqueue position; with a single consumer the dequeue position is advanced without any CAS.
+ *
+ * @tparam Consumers Number of threads allowed to consume the channel at the same time.
+ * @tparam Types Argument types of the Event the channel is drained to.
+ */
+template <ChannelConsumers Consumers, typename... Types>
+class BasicEventChannel {
+public:
+
+    /// Stored form of the arguments of one event
+    using Arguments = std::tuple<std::decay_t<Types>...>;
+
+    /// Maximum number of events popped before dispatching them by Drain
+    static constexpr std::size_t DrainBatchSize = 64;
+
+private:
+
+    static constexpr std::size_t CacheLineSize = 64;
+
+    struct alignas(CacheLineSize) Cell {
+        std::atomic<std::size_t> sequence;
+        alignas(Arguments) unsigned char storage[sizeof(Arguments)];
+
+        Arguments* Get() {
+            return std::launder(reinterpret_cast<Arguments*>(storage));
+        }
+    };
+
+    std::unique_ptr<Cell[]> _cells;
+    std::size_t _mask;
+
+    alignas(CacheLineSize) std::atomic<std::size_t> _enqueuePosition{ 0 };
+    alignas(CacheLineSize) std::atomic<std::size_t> _dequeuePosition{ 0 };
+
+    static std::size_t RoundUpToPowerOfTwo(std::size_t value) {
+        std::size_t power = 2;
+        while (power < value)
+            power *= 2;
+        return power;
+    }
+
+    template <typename... Args>
+    bool TryEmplace(Args&&... args) {
+        std::size_t position = _enqueuePosition.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &_cells[position & _mask];
+            std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            std::intptr_t difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+            if (difference == 0) {
+                if (_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (difference < 0)
+                return false; // full
+            else
+                position = _enqueuePosition.load(std::memory_order_relaxed);
+        }
+
+        new (cell->storage) Arguments(std::forward<Args>(args)...);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+public:
+
+    /**
+     * @brief Create a channel.
+     * @param capacity Maximum number of events in flight, rounded up to a power of two.
+     */
+    explicit BasicEventChannel(std::size_t capacity)
+        : _cells(new Cell[RoundUpToPowerOfTwo(capacity)]), _mask(RoundUpToPowerOfTwo(capacity) - 1) {
+        for (std::size_t i = 0; i <= _mask; ++i)
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    BasicEventChannel(const BasicEventChannel&) = delete;
+    BasicEventChannel& operator=(const BasicEventChannel&) = delete;
+
+    /**
+     * @brief Destroy the channel and the events still queued, no thread may be using it anymore.
+     */
+    ~BasicEventChannel() {
+        for (std::size_t position = _dequeuePosition.load(std::memory_order_relaxed);; ++position) {
+            Cell& cell = _cells[position & _mask];
+            if (cell.sequence.load(std::memory_order_acquire) != position + 1)
+                break;
+            cell.Get()->~Arguments();
+        }
+    }
+
+    /**
+     * @brief Post an event if the channel is not full, from any thread.
+     * @param args Arguments the event will be triggered with.
+     * @return false if the channel was full.
+     */
+    bool TryPush(event_detail::Param<Types>... args) {
+        return TryEmplace(args...);
+    }
+
+    /**
+     * @brief Post an event, waiting for room if the channel is full, from any thread.
+     * @param args Arguments the event will be triggered with.
+     */
+    void Push(event_detail::Param<Types>... args) {
+        while (!TryEmplace(args...))
+            std::this_thread::yield();
+    }
+
+    /**
+     * @brief Take the oldest event out of the channel.
+     * @param arguments Receives the arguments of the event.
+     * @return false if the channel was empty.
+     */
+    bool TryPop(Arguments& arguments) {
+        std::size_t position = _dequeuePosition.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &_cells[position & _mask];
+            std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            std::intptr_t difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position + 1);
+            if (difference == 0) {
+                if constexpr (Consumers == ChannelConsumers::Single) {
+                    _dequeuePosition.store(position + 1, std::memory_order_relaxed);
+                    break;
+                }
+                else if (_dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (difference < 0)
+                return false; // empty
+            else
+                position = _dequeuePosition.load(std::memory_order_relaxed);
+        }
+
+        Arguments* stored = cell->Get();
+        arguments = std::move(*stored);
+        stored->~Arguments();
+        cell->sequence.store(position + _mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Trigger an event with the queued events, popping and dispatching them in batches.
+     *
+     * Must be called from a consumer thread, the only one triggering the event. The argument types
+     * must be default constructible, as events are popped into a reused buffer.
+     * @param event Event to trigger, Event<Types...> or any BasicEvent with the same argument types.
+     * @param maxCount Maximum number of events to dispatch.
+     * @param order Order in which the listeners are called within a batch.
+     * @return Number of events dispatched.
+     */
+    template <typename Allocator, std::size_t InlineCapacity>
+    std::size_t Drain(const BasicEvent<Allocator, InlineCapacity, Types...>& event, std::size_t maxCount = SIZE_MAX,
+        FlushOrder order = FlushOrder::EventByEvent) {
+        // Per-thread buffer reused across calls, taken out while in use in case a listener drains too.
+        static thread_local std::vector<Arguments> cache;
+        std::vector<Arguments> batch = std::move(cache);
+        batch.resize(DrainBatchSize);
+
+        std::size_t dispatched = 0;
+        while (dispatched < maxCount) {
+            std::size_t count = 0;
+            std::size_t wanted = std::min(DrainBatchSize, maxCount - dispatched);
+            while (count < wanted && TryPop(batch[count]))
+                ++count;
+            if (count == 0)
+                break;
+
+            if (order == FlushOrder::ListenerByListener)
+                event.TriggerBatch(batch.data(), count);
+            else {
+                for (std::size_t i = 0; i < count; ++i)
+                    std::apply([&event](const auto&... args) { event.Trigger(args...); }, batch[i]);
+            }
+            for (std::size_t i = 0; i < count; ++i)
+                batch[i] = Arguments(); // release the payloads now, not when the buffer is reused
+            dispatched += count;
+        }
+
+        cache = std::move(batch);
+        return dispatched;
+    }
+
+    /// @return Maximum number of events in flight.
+    std::size_t Capacity() const {
+        return _mask + 1;
+    }
+};
+
+/// Channel with any number of producers and a single consumer thread.
+template <typename... Types>
+using MpscEventChannel = BasicEventChannel<ChannelConsumers::Single, Types...>;
+
+/// Channel with any number of producers and consumers.
+template <typename... Types>
+using MpmcEventChannel = BasicEventChannel<ChannelConsumers::Multiple, Types...>;
@@ -0,0 +1,254 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "Connection.h"
+
+/**
+ * @file EventProfiling.h
+ * @brief Per-event and per-listener dispatch statistics, recorded when TOOLBOX_EVENT_PROFILING is defined.
+ *
+ * Defining TOOLBOX_EVENT_PROFILING (identically in every translation unit) makes Event and
+ * ResultEvent time each dispatch and each listener call, and adds Profile() and ResetProfile()
+ * to them. Without it nothing is recorded and the events carry no extra state.
+ *
+ * Timed paths are Trigger, TriggerMove, TriggerBatch and TriggerParallel; the times of a dispatch
+ * include the nested dispatches it causes.
+ */
+
+/**
+ * @brief Latency histogram with log-linear buckets, in the spirit of HdrHistogram.
+ *
+ * Values below 2 * SubBucketCount are exact. Above, each power of two is split into SubBucketCount
+ * buckets, so a value is known within 1 / SubBucketCount (12.5%) of its magnitude.
+ */
+class LatencyHistogram {
+public:
+
+    /// Log2 of the number of buckets per power of two
+    static constexpr unsigned SubBucketBits = 3;
+
+    /// Number of buckets per power of two
+    static constexpr std::size_t SubBucketCount = std::size_t(1) << SubBucketBits;
+
+    /// Number of buckets covering the whole 64-bit range
+    static constexpr std::size_t BucketCount = (64 - SubBucketBits + 1) * SubBucketCount;
+
+    /// @return Bucket holding a value.
+    static std::size_t BucketOf(std::uint64_t value) {
+        if (value < SubBucketCount)
+            return static_cast<std::size_t>(value);
+        unsigned magnitude = HighestBit(value);
+        unsigned shift = magnitude - SubBucketBits;
+        return (shift + 1) * SubBucketCount + static_cast<std::size_t>((value >> shift) - SubBucketCount);
+    }
+
+    /// @return Largest value held by a bucket.
+    static std::uint64_t BucketUpperBound(std::size_t bucket) {
+        if (bucket < 2 * SubBucketCount)
+            return bucket;
+        unsigned shift = static_cast<unsigned>(bucket / SubBucketCount - 1);
+        std::uint64_t lower = static_cast<std::uint64_t>(bucket % SubBucketCount + SubBucketCount) << shift;
+        return lower + ((std::uint64_t(1) << shift) - 1);
+    }
+
+    /**
+     * @brief Count a value.
+     * @param value Value, such as a duration in nanoseconds.
+     * @param count Number of times the value was observed.
+     */
+    void Record(std::uint64_t value, std::uint64_t count = 1) {
+        _buckets[BucketOf(value)] += count;
+        _count += count;
+    }
+
+    /// @return Number of recorded values.
+    std::uint64_t Count() const {
+        return _count;
+    }
+
+    /**
+     * @brief Value below which a fraction of the recorded values are.
+     * @param percentile Percentile in [0, 100].
+     * @return Upper bound of the bucket holding that value, 0 if nothing was recorded.
+     */
+    std::uint64_t Percentile(double percentile) const {
+        if (_count == 0)
+            return 0;
+        double rank = percentile / 100.0 * static_cast<double>(_count);
+        std::uint64_t target = rank <= 1.0 ? 1 : static_cast<std::uint64_t>(rank + 0.5);
+        std::uint64_t seen = 0;
+        for (std::size_t bucket = 0; bucket < BucketCount; ++bucket) {
+            seen += _buckets[bucket];
+            if (seen >= target)
+                return BucketUpperBound(bucket);
+        }
+        return BucketUpperBound(BucketCount - 1);
+    }
+
+    /// @return Number of values recorded in each bucket.
+    const std::array<std::uint64_t, BucketCount>& Buckets() const {
+        return _buckets;
+    }
+
+private:
+
+    std::array<std::uint64_t, BucketCount> _buckets{};
+    std::uint64_t _count = 0;
+
+    static unsigned HighestBit(std::uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#else
+        unsigned bit = 0;
+        while (value >>= 1)
+            ++bit;
+        return bit;
+#endif
+    }
+};
+
+/**
+ * @brief Statistics of one listener, copied out of an event by Profile().
+ */
+struct ListenerProfile {
+    Connection connection;    ///< Connection of the listener
+    void* instancePtr;        ///< Bound instance, nullptr for free functions
+    void* functionPtr;        ///< Address of the function or method, or its vtable offset for a virtual method
+    int priority;             ///< Priority of the listener
+    std::uint64_t calls;      ///< Number of calls
+    std::uint64_t totalNs;    ///< Time spent in the listener
+    std::uint64_t maxNs;      ///< Longest call
+    LatencyHistogram latency; ///< Duration of the calls, in nanoseconds
+};
+
+/**
+ * @brief Statistics of an event and its listeners, copied out of the event by Profile().
+ */
+struct EventProfile {
+    std::uint64_t dispatches;               ///< Number of dispatches
+    std::uint64_t totalNs;                  ///< Time spent dispatching
+    std::uint64_t maxNs;                    ///< Longest dispatch
+    LatencyHistogram latency;               ///< Duration of the dispatches, in nanoseconds
+    std::vector<ListenerProfile> listeners; ///< Registered listeners, in dispatch order
+};
+
+namespace event_detail {
+
+    /// @return Monotonic time in nanoseconds used to time dispatches.
+    inline std::uint64_t ProfilingClock() {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    /**
+     * @brief Counters of one dispatch target, updated with relaxed atomics so that TriggerParallel can record concurrently.
+     */
+    struct DispatchStats {
+        std::atomic<std::uint64_t> calls{ 0 };
+        std::atomic<std::uint64_t> totalNs{ 0 };
+        std::atomic<std::uint64_t> maxNs{ 0 };
+        std::array<std::atomic<std::uint64_t>, LatencyHistogram::BucketCount> buckets{};
+
+        void Record(std::uint64_t ns) {
+            calls.fetch_add(1, std::memory_order_relaxed);
+            totalNs.fetch_add(ns, std::memory_order_relaxed);
+            buckets[LatencyHistogram::BucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+            std::uint64_t max = maxNs.load(std::memory_order_relaxed);
+            while (ns > max && !maxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {}
+        }
+
+        void Clear() {
+            calls.store(0, std::memory_order_relaxed);
+            totalNs.store(0, std::memory_order_relaxed);
+            maxNs.store(0, std::memory_order_relaxed);
+            for (auto& bucket : buckets)
+                bucket.store(0, std::memory_order_relaxed);
+        }
+
+        LatencyHistogram Histogram() const {
+            LatencyHistogram histogram;
+            for (std::size_t i = 0; i < LatencyHistogram::BucketCount; ++i) {
+                if (std::uint64_t count = buckets[i].load(std::memory_order_relaxed))
+                    histogram.Record(LatencyHistogram::BucketUpperBound(i), count);
+            }
+            return histogram;
+        }
+    };
+
+    /**
+     * @brief Statistics of a listener slot, only recorded while the slot holds the same listener.
+     */
+    struct ListenerStats : DispatchStats {
+        std::uint32_t generation = 0; ///< Generation of the slot when the listener was added
+    };
+
+    /**
+     * @brief Dispatch statistics of a listener list, indexed by listener slot.
+     *
+     * Copies start with empty statistics. The slot statistics live in a deque so that adding a
+     * listener during a dispatch does not move the statistics being recorded.
+     */
+    class EventProfiler {
+        std::deque<ListenerStats> _listeners;
+        DispatchStats _dispatches;
+
+    public:
+
+        EventProfiler() = default;
+        EventProfiler(const EventProfiler&) {}
+        EventProfiler& operator=(const EventProfiler&) { return *this; }
+
+        /// Start recording a listener added to a slot.
+        void Track(std::uint32_t slot, std::uint32_t generation) {
+            while (_listeners.size() <= slot)
+                _listeners.emplace_back();
+            _listeners[slot].Clear();
+            _listeners[slot].generation = generation;
+        }
+
+        /// Start recording every listener of a slot map, dropping the previous statistics.
+        template <typename Slot>
+        void TrackAll(const Slot* slots, std::size_t count) {
+            _listeners.clear();
+            for (std::uint32_t i = 0; i < count; ++i)
+                Track(i, slots[i].generation);
+            _dispatches.Clear();
+        }
+
+        void RecordDispatch(std::uint64_t ns) {
+            _dispatches.Record(ns);
+        }
+
+        void RecordListener(std::uint32_t slot, std::uint32_t generation, std::uint64_t ns) {
+            ListenerStats& stats = _listeners[slot];
+            if (stats.generation == generation)
+                stats.Record(ns);
+        }
+
+        /// Clear every statistic, keeping the tracked listeners.
+        void Clear() {
+            for (ListenerStats& stats : _listeners)
+                stats.Clear();
+            _dispatches.Clear();
+        }
+
+        /// @return Statistics of the event, without listeners.
+        EventProfile Dispatches() const {
+            return { _dispatches.calls.load(std::memory_order_relaxed), _dispatches.totalNs.load(std::memory_order_relaxed),
+                _dispatches.maxNs.load(std::memory_order_relaxed), _dispatches.Histogram(), {} };
+        }
+
+        /// @return Statistics of the listener in a slot.
+        ListenerProfile Listener(Connection connection, void* instancePtr, void* functionPtr, int priority) const {
+            const ListenerStats& stats = _listeners[connection.index];
+            return { connection, instancePtr, functionPtr, priority, stats.calls.load(std::memory_order_relaxed),
+                stats.totalNs.load(std::memory_order_relaxed), stats.maxNs.load(std::memory_order_relaxed), stats.Histogram() };
+        }
+    };
+
+}
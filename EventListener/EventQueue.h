@@ -0,0 +1,155 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Event.h"
+
+/**
+ * @file EventQueue.h
+ * @brief Deferred event dispatching, flushed in batches.
+ */
+
+/**
+ * @brief Order in which EventQueue::Flush calls the listeners.
+ */
+enum class FlushOrder {
+    EventByEvent,       ///< Same as calling Trigger for each queued event
+    ListenerByListener, ///< Each listener processes every queued event before the next listener runs
+};
+
+/**
+ * @brief Queue of event arguments, dispatched later to an Event in one batch.
+ *
+ * Arguments are stored as tuples in a contiguous buffer reused from one flush to the next, so a
+ * queue that reached its working size no longer allocates. Events queued by listeners while the
+ * queue is flushed are kept for the next flush.
+ *
+ * @tparam Types Argument types of the Event the queue is flushed to.
+ */
+template <typename... Types>
+class EventQueue {
+public:
+
+    /// Stored form of the arguments of one event
+    using Arguments = std::tuple<std::decay_t<Types>...>;
+
+private:
+
+    std::vector<Arguments> _events;
+
+    /// Scratch buffers of Deduplicate, kept to reuse their capacity
+    std::vector<std::size_t> _order;
+    std::vector<unsigned char> _duplicate;
+
+public:
+
+    /**
+     * @brief Queue an event.
+     * @param args Arguments the event will be triggered with.
+     */
+    void Enqueue(event_detail::Param<Types>... args) {
+        _events.emplace_back(args...);
+    }
+
+    /**
+     * @brief Queue an event, constructing its arguments in place.
+     * @param args Values the stored arguments are constructed from.
+     */
+    template <typename... Args>
+    void Emplace(Args&&... args) {
+        _events.emplace_back(std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Queue an event unless it is equal to the last queued one.
+     * @param args Arguments the event will be triggered with.
+     * @return false if the event was coalesced with the previous one.
+     */
+    bool EnqueueCoalesced(event_detail::Param<Types>... args) {
+        if (!_events.empty() && _events.back() == std::forward_as_tuple(args...))
+            return false;
+        _events.emplace_back(args...);
+        return true;
+    }
+
+    /**
+     * @brief Drop every queued event equal to an event queued before it.
+     *
+     * Runs in O(n log n) and requires the argument types to be ordered with operator<.
+     */
+    void Deduplicate() {
+        const std::size_t count = _events.size();
+        _order.resize(count);
+        std::iota(_order.begin(), _order.end(), std::size_t(0));
+        std::stable_sort(_order.begin(), _order.end(), [this](std::size_t a, std::size_t b) {
+            return _events[a] < _events[b];
+        });
+
+        _duplicate.assign(count, 0);
+        for (std::size_t i = 1; i < count; ++i) {
+            if (!(_events[_order[i - 1]] < _events[_order[i]]))
+                _duplicate[_order[i]] = 1;
+        }
+
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (!_duplicate[i]) {
+                if (kept != i)
+                    _events[kept] = std::move(_events[i]);
+                ++kept;
+            }
+        }
+        _events.erase(_events.begin() + kept, _events.end());
+    }
+
+    /**
+     * @brief Trigger the event for every queued event and empty the queue.
+     * @param event Event to trigger, Event<Types...> or any BasicEvent with the same argument types.
+     * @param order Order in which the listeners are called.
+     */
+    template <typename Allocator, std::size_t InlineCapacity>
+    void Flush(const BasicEvent<Allocator, InlineCapacity, Types...>& event, FlushOrder order = FlushOrder::EventByEvent) {
+        std::vector<Arguments> batch;
+        batch.swap(_events);
+
+        if (order == FlushOrder::ListenerByListener)
+            event.TriggerBatch(batch.data(), batch.size());
+        else {
+            for (const Arguments& arguments : batch)
+                std::apply([&event](const auto&... args) { event.Trigger(args...); }, arguments);
+        }
+
+        batch.clear();
+        if (_events.empty())
+            _events.swap(batch); // reuse the buffer capacity
+    }
+
+    /**
+     * @brief Drop every queued event.
+     */
+    void Clear() {
+        _events.clear();
+    }
+
+    /// @return Number of queued events.
+    std::size_t Size() const {
+        return _events.size();
+    }
+
+    /// @return true if no event is queued.
+    bool Empty() const {
+        return _events.empty();
+    }
+
+    /**
+     * @brief Reserve room for a number of events, to avoid allocating while queueing.
+     * @param capacity Number of events.
+     */
+    void Reserve(std::size_t capacity) {
+        _events.reserve(capacity);
+    }
+};
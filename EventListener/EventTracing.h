@@ -0,0 +1,227 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * @file EventTracing.h
+ * @brief Dispatch timeline recording, enabled in the events when TOOLBOX_EVENT_TRACING is defined.
+ *
+ * Defining TOOLBOX_EVENT_TRACING (identically in every translation unit) makes Event and
+ * ResultEvent record a span for each dispatch and each listener call while EventTracer is started.
+ * The spans are written as Chrome Trace JSON, which chrome://tracing and the Perfetto UI open,
+ * showing events triggered by listeners nested under them.
+ */
+
+/**
+ * @brief Span recorded by the tracer.
+ */
+struct TraceSpan {
+    const char* name;     ///< Static name of the event
+    const void* listener; ///< Function pointer of the listener, nullptr for the dispatch span
+    std::uint64_t begin;  ///< Start, in clock ticks
+    std::uint64_t end;    ///< End, in clock ticks
+};
+
+/**
+ * @brief Process-wide recorder of dispatch spans.
+ *
+ * Each thread writes its spans to its own fixed-capacity buffer without any synchronization
+ * but a release store, so a span costs two clock reads and a few stores. The buffer of a thread is
+ * allocated on its first span and lives until the end of the process; spans are dropped and
+ * counted once it is full.
+ *
+ * The clock is the time-stamp counter on x86, converted to time when the trace is written.
+ */
+class EventTracer {
+public:
+
+    /// Default number of spans per thread buffer
+    static constexpr std::size_t DefaultCapacity = std::size_t(1) << 16;
+
+    /// @return Current clock value, in ticks.
+    static std::uint64_t Now() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    /**
+     * @brief Start recording spans.
+     * @param capacity Number of spans of the buffers allocated from now on.
+     */
+    static void Start(std::size_t capacity = DefaultCapacity) {
+        State& state = GetState();
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.capacity = capacity;
+            if (state.startTicks == 0) {
+                state.startTicks = Now();
+                state.startTime = std::chrono::steady_clock::now();
+            }
+        }
+        state.enabled.store(true, std::memory_order_release);
+    }
+
+    /// Stop recording spans, the recorded ones are kept.
+    static void Stop() {
+        GetState().enabled.store(false, std::memory_order_release);
+    }
+
+    /// @return true between Start and Stop.
+    static bool IsEnabled() {
+        return GetState().enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Record a span in the buffer of the calling thread.
+     * @param name Static name of the event.
+     * @param listener Function pointer of the listener, nullptr for a dispatch.
+     * @param begin Start, from Now().
+     */
+    static void Record(const char* name, const void* listener, std::uint64_t begin) {
+        std::uint64_t end = Now();
+        Buffer& buffer = LocalBuffer();
+        std::size_t count = buffer.count.load(std::memory_order_relaxed);
+        if (count == buffer.capacity) {
+            buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        buffer.spans[count] = { name, listener, begin, end };
+        buffer.count.store(count + 1, std::memory_order_release);
+    }
+
+    /// @return Number of spans dropped because a thread buffer was full.
+    static std::uint64_t DroppedCount() {
+        State& state = GetState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        std::uint64_t dropped = 0;
+        for (const auto& buffer : state.buffers)
+            dropped += buffer->dropped.load(std::memory_order_relaxed);
+        return dropped;
+    }
+
+    /**
+     * @brief Write the recorded spans as Chrome Trace JSON, while threads may still be recording.
+     * @param out Stream receiving the trace.
+     */
+    static void WriteChromeTrace(std::ostream& out) {
+        State& state = GetState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        double ticksPerMicrosecond = TicksPerMicrosecond(state);
+
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first = true;
+        char number[32];
+        for (const auto& buffer : state.buffers) {
+            std::size_t count = buffer->count.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < count; ++i) {
+                const TraceSpan& span = buffer->spans[i];
+                out << (first ? "\n" : ",\n") << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadIndex << ",\"name\":";
+                WriteString(out, span.name);
+                std::snprintf(number, sizeof(number), "%.3f", static_cast<double>(span.begin - state.startTicks) / ticksPerMicrosecond);
+                out << ",\"ts\":" << number;
+                std::snprintf(number, sizeof(number), "%.3f", static_cast<double>(span.end - span.begin) / ticksPerMicrosecond);
+                out << ",\"dur\":" << number;
+                if (span.listener != nullptr) {
+                    std::snprintf(number, sizeof(number), "%p", span.listener);
+                    out << ",\"cat\":\"listener\",\"args\":{\"function\":\"" << number << "\"}";
+                }
+                else
+                    out << ",\"cat\":\"dispatch\"";
+                out << '}';
+                first = false;
+            }
+        }
+        out << "\n]}\n";
+    }
+
+    /**
+     * @brief Forget the recorded spans. No thread may be recording.
+     */
+    static void Clear() {
+        State& state = GetState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        for (const auto& buffer : state.buffers) {
+            buffer->count.store(0, std::memory_order_relaxed);
+            buffer->dropped.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+
+    struct Buffer {
+        std::unique_ptr<TraceSpan[]> spans;
+        std::size_t capacity;
+        std::uint32_t threadIndex;
+        std::atomic<std::size_t> count{ 0 };
+        std::atomic<std::uint64_t> dropped{ 0 };
+    };
+
+    struct State {
+        std::atomic<bool> enabled{ false };
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Buffer>> buffers;
+        std::size_t capacity = DefaultCapacity;
+        std::uint64_t startTicks = 0;
+        std::chrono::steady_clock::time_point startTime;
+    };
+
+    static State& GetState() {
+        static State state;
+        return state;
+    }
+
+    static Buffer& LocalBuffer() {
+        static thread_local Buffer* local = nullptr;
+        if (local == nullptr) {
+            State& state = GetState();
+            std::lock_guard<std::mutex> lock(state.mutex);
+            auto buffer = std::make_unique<Buffer>();
+            buffer->spans.reset(new TraceSpan[state.capacity]);
+            buffer->capacity = state.capacity;
+            buffer->threadIndex = static_cast<std::uint32_t>(state.buffers.size());
+            local = buffer.get();
+            state.buffers.push_back(std::move(buffer));
+        }
+        return *local;
+    }
+
+    /// Measure the clock rate against steady_clock since Start.
+    static double TicksPerMicrosecond(const State& state) {
+        double elapsedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - state.startTime).count();
+        std::uint64_t elapsedTicks = Now() - state.startTicks;
+        if (state.startTicks == 0 || elapsedUs <= 0.0 || elapsedTicks == 0)
+            return 1000.0;
+        return static_cast<double>(elapsedTicks) / elapsedUs;
+    }
+
+    static void WriteString(std::ostream& out, const char* text) {
+        out << '"';
+        for (const char* c = text; *c != '\0'; ++c) {
+            if (*c == '"' || *c == '\\')
+                out << '\\' << *c;
+            else if (static_cast<unsigned char>(*c) < 0x20)
+                out << ' ';
+            else
+                out << *c;
+        }
+        out << '"';
+    }
+};
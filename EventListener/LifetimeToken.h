@@ -0,0 +1,61 @@
+#pragma once
+#include <memory>
+
+/**
+ * @file LifetimeToken.h
+ * @brief Token tracking the lifetime of an object, so that events can hold weak listeners to it.
+ */
+
+/**
+ * @brief Member whose destruction expires the listeners added with it.
+ *
+ * Objects not owned by a std::shared_ptr embed a token and pass it when adding their methods.
+ * The events then skip and prune the listeners once the object is destroyed, without any explicit
+ * removal:
+ * @code
+ * class Player {
+ *     LifetimeToken _lifetime;
+ * public:
+ *     explicit Player(Event<int>& onDamage) {
+ *         onDamage.AddListener(this, &Player::OnDamage, _lifetime);
+ *     }
+ *     void OnDamage(int amount);
+ * };
+ * @endcode
+ *
+ * A token is tied to the address of its object: copying or moving an object gives the new object a
+ * token of its own, and assigning to an object keeps its token. The shared state is allocated the
+ * first time a listener is added with the token.
+ */
+class LifetimeToken {
+    mutable std::shared_ptr<const void> _state;
+
+public:
+
+    LifetimeToken() = default;
+
+    /// The copy is another object, with its own lifetime.
+    LifetimeToken(const LifetimeToken&) noexcept {}
+
+    /// Keeps the lifetime of this object.
+    LifetimeToken& operator=(const LifetimeToken&) noexcept {
+        return *this;
+    }
+
+    /**
+     * @brief Observe the lifetime of the object.
+     * @return Weak reference expiring when the token is destroyed or reset.
+     */
+    std::weak_ptr<const void> Watch() const {
+        if (!_state)
+            _state = std::make_shared<char>();
+        return _state;
+    }
+
+    /**
+     * @brief Expire every listener added with the token so far, as if the object was destroyed.
+     */
+    void Reset() {
+        _state.reset();
+    }
+};
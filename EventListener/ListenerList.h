@@ -0,0 +1,1183 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Connection.h"
+#include "LifetimeToken.h"
+#include "ListenerStorage.h"
+#ifdef TOOLBOX_EVENT_PROFILING
+#include "EventProfiling.h"
+#endif
+#ifdef TOOLBOX_EVENT_TRACING
+#include "EventTracing.h"
+#endif
+
+/**
+ * @file ListenerList.h
+ * @brief Listener storage shared by the Event classes.
+ *
+ * Listeners are kept in a dense array sorted by decreasing priority, listeners of equal priority in
+ * insertion order, and addressed through a slot map so that a listener can be removed in O(1) from
+ * the Connection returned when it was added. The array is split in two: the callbacks, which are all
+ * a dispatch reads, and the identity, slot and flags of each listener, which only adding and
+ * removing listeners read. Both halves and the slot map share one buffer.
+ *
+ * Listeners may add or remove listeners of the event dispatching them. A removed listener is not
+ * called anymore, even by the dispatch in progress. An added listener is kept aside and joins the
+ * dense array when the outermost dispatch ends, so it is first called by the next dispatch.
+ */
+
+namespace event_detail {
+
+    /**
+     * @brief Dense listener array addressed through a slot map.
+     *
+     * Removing a listener clears its callback and frees its slot immediately. The dense array is
+     * compacted once half of it is made of removed entries, which keeps removal O(1) amortized
+     * while preserving the dispatch order. Adding a listener appends it when its priority is not
+     * higher than the last one (always the case with the default priority), and otherwise inserts it
+     * at the end of its priority range, without re-sorting.
+     *
+     * With an InlineCapacity, the first listeners and their slots are stored in the list itself, so
+     * an event with few listeners never allocates. The rest of the state, needed by few events, is
+     * kept in a side block allocated on first use.
+     *
+     * Weak listeners are bound to an object observed through a std::weak_ptr, coming from a
+     * std::shared_ptr or a LifetimeToken, and flagged next to their callback. Dispatching checks
+     * whether the object of a flagged listener expired, which is a load without reference count
+     * change, and clears the callback of an expired listener so it is skipped at no cost from then
+     * on. Expired listeners stay in the list until a listener is added while the ones found by
+     * dispatching make up half of the list, which removes them in one pass, or until
+     * PruneExpiredListeners.
+     *
+     * Once IdentityIndexThreshold listeners are registered, an open-addressing hash table from
+     * (instance, function) to slot is maintained as well, so removing listeners by identity no
+     * longer scans the array. Smaller lists keep scanning, which is faster for them.
+     *
+     * @tparam Callback Callable type stored for each listener.
+     * @tparam Allocator Allocator of the listener storage, rebound to the internal types.
+     * @tparam InlineCapacity Number of listeners stored without allocating.
+     */
+    template <typename Callback, typename Allocator = std::allocator<std::byte>, std::size_t InlineCapacity = 0>
+    class ListenerList : public ConnectionOwner {
+    protected:
+
+        /// Vector using the allocator of the list
+        template <typename T>
+        using Vector = std::vector<T, typename std::allocator_traits<Allocator>::template rebind_alloc<T>>;
+
+        /// Whether moving a list never allocates, the listener statistics are reallocated when profiling
+#ifdef TOOLBOX_EVENT_PROFILING
+        static constexpr bool NothrowMove = false;
+#else
+        static constexpr bool NothrowMove = true;
+#endif
+
+        /// Whether move assignment always takes the storage of the source instead of moving the elements
+        static constexpr bool NothrowMoveAssign = NothrowMove
+            && (std::allocator_traits<Allocator>::propagate_on_container_move_assignment::value
+                || std::allocator_traits<Allocator>::is_always_equal::value);
+
+        /// Number of registered listeners from which removal by identity goes through a hash index
+        static constexpr std::size_t IdentityIndexThreshold = 32;
+
+        /**
+         * @brief Bookkeeping of a registered listener, stored apart from its callback.
+         */
+        struct Listener {
+            void* instancePtr;   ///< Pointer to the object instance (or nullptr for free functions)
+            FunctionId functionId; ///< Identity of the function or method, used for removal
+            std::uint32_t slot;  ///< Slot pointing to this listener, InvalidIndex once removed
+            int priority;        ///< Listeners with a higher priority are called first
+        };
+
+        /// Flag of a weak listener, whose instance lifetime is observed in Extras::lifetimes
+        static constexpr std::uint8_t WeakFlag = 1;
+
+        /// Flag of a listener that may run concurrently with the other listeners
+        static constexpr std::uint8_t ParallelSafeFlag = 2;
+
+        /**
+         * @brief Entry of the identity index.
+         */
+        struct IndexEntry {
+            std::uint32_t slot; ///< Slot of the listener, InvalidIndex for an empty entry
+            std::uint32_t hash; ///< Hash of the listener identity
+        };
+
+        /**
+         * @brief Entry of the slot map.
+         */
+        struct Slot {
+            std::uint32_t index;      ///< Position in the listeners when used, next free slot otherwise
+            std::uint32_t generation; ///< Incremented each time the slot is freed
+            ScopedConnection* scoped; ///< Scoped connection owning the listener, if any
+        };
+
+        using Storage = ListenerStorage<Callback, Listener, Slot, InlineCapacity, Allocator>;
+
+        /// Callables of the listeners in dispatch order, empty for removed entries waiting for compaction
+        /// and for expired weak listeners, which dispatching clears, followed by the bookkeeping of the
+        /// listeners, by the slot map from connections to positions in the listeners, and by the flags
+        /// of the listeners, which dispatching reads
+        Storage _storage;
+
+        /// Head of the free slot list
+        std::uint32_t _freeSlot = Connection::InvalidIndex;
+
+        /// Number of removed entries still present in the listeners
+        std::uint32_t _removedCount = 0;
+
+        /// Number of slots owned by a scoped connection
+        std::uint32_t _scopedCount = 0;
+
+        /// Number of dispatches in progress, including nested ones
+        mutable std::uint32_t _dispatchDepth = 0;
+
+        /**
+         * @brief State only needed by events with weak listeners, many listeners, or listeners added
+         * while dispatching, kept out of the event object so that events embedded in many objects
+         * stay small.
+         */
+        struct Extras {
+            explicit Extras(const Allocator& allocator)
+                : pending(allocator), pendingCallbacks(allocator), pendingFlags(allocator), lifetimes(allocator),
+                index(allocator) {}
+
+            /// Listeners added during a dispatch, logically following the listeners of the storage
+            Vector<Listener> pending;
+
+            /// Callables of the listeners added during a dispatch, parallel to pending
+            Vector<Callback> pendingCallbacks;
+
+            /// Flags of the listeners added during a dispatch, parallel to pending
+            Vector<std::uint8_t> pendingFlags;
+
+            /// Lifetime of the instance of each weak listener, indexed by slot, empty until a weak listener is added
+            Vector<std::weak_ptr<const void>> lifetimes;
+
+            /// Identity index with linear probing, power of two sized and at most half full, empty below the threshold
+            Vector<IndexEntry> index;
+
+            /// Number of registered weak listeners
+            std::uint32_t weakCount = 0;
+
+            /// Number of weak listeners whose callback was cleared because their instance expired
+            std::uint32_t expiredCount = 0;
+        };
+
+        using ExtrasAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Extras>;
+
+        /// Deferred additions, weak listener and identity index state, allocated the first time one is needed
+        Extras* _extras = nullptr;
+
+#ifdef TOOLBOX_EVENT_PROFILING
+        /// Dispatch and listener statistics
+        mutable EventProfiler _profiler;
+#endif
+
+#ifdef TOOLBOX_EVENT_TRACING
+        /// Name of the spans recorded by EventTracer
+        const char* _traceName = "Event";
+#endif
+
+        /**
+         * @brief RAII marker of a dispatch in progress.
+         *
+         * While a dispatch is in progress no listener is inserted and the listeners are not compacted,
+         * so they can be iterated by position while listeners add or remove listeners.
+         */
+        class DispatchGuard {
+            const ListenerList& _list;
+#ifdef TOOLBOX_EVENT_PROFILING
+            std::uint64_t _start = ProfilingClock();
+#endif
+#ifdef TOOLBOX_EVENT_TRACING
+            std::uint64_t _traceStart = EventTracer::IsEnabled() ? EventTracer::Now() : 0;
+#endif
+        public:
+            explicit DispatchGuard(const ListenerList& list) : _list(list) {
+                ++_list._dispatchDepth;
+            }
+
+            ~DispatchGuard() {
+#ifdef TOOLBOX_EVENT_PROFILING
+                _list._profiler.RecordDispatch(ProfilingClock() - _start);
+#endif
+#ifdef TOOLBOX_EVENT_TRACING
+                if (_traceStart != 0)
+                    EventTracer::Record(_list._traceName, nullptr, _traceStart);
+#endif
+                if (--_list._dispatchDepth == 0 && _list.HasDeferredWork()) {
+                    // Deferred work only exists if a non-const member was called during the dispatch,
+                    // so the list is not a const object and casting away constness is well-defined.
+                    const_cast<ListenerList&>(_list).ApplyDeferred();
+                }
+            }
+
+            DispatchGuard(const DispatchGuard&) = delete;
+            DispatchGuard& operator=(const DispatchGuard&) = delete;
+        };
+
+        /**
+         * @brief RAII timer of a listener call, only recording when TOOLBOX_EVENT_PROFILING or
+         * TOOLBOX_EVENT_TRACING is defined.
+         */
+        class ListenerTimer {
+#ifdef TOOLBOX_EVENT_PROFILING
+            const ListenerList& _list;
+            std::uint32_t _slot;
+            std::uint32_t _generation;
+            std::uint64_t _start;
+#endif
+#ifdef TOOLBOX_EVENT_TRACING
+            const char* _traceName;
+            const void* _traceListener;
+            std::uint64_t _traceStart;
+#endif
+        public:
+            ListenerTimer(const ListenerList& list, std::size_t position)
+#ifdef TOOLBOX_EVENT_PROFILING
+                : _list(list), _slot(list._storage.Listeners()[position].slot), _generation(list._storage.Slots()[_slot].generation),
+                _start(ProfilingClock())
+#endif
+            {
+#ifdef TOOLBOX_EVENT_TRACING
+                _traceName = list._traceName;
+                _traceListener = list._storage.Listeners()[position].functionId.Address();
+                _traceStart = EventTracer::IsEnabled() ? EventTracer::Now() : 0;
+#endif
+                (void)list;
+                (void)position;
+            }
+
+            ~ListenerTimer() {
+#ifdef TOOLBOX_EVENT_PROFILING
+                _list._profiler.RecordListener(_slot, _generation, ProfilingClock() - _start);
+#endif
+#ifdef TOOLBOX_EVENT_TRACING
+                if (_traceStart != 0)
+                    EventTracer::Record(_traceName, _traceListener, _traceStart);
+#endif
+            }
+
+            ListenerTimer(const ListenerTimer&) = delete;
+            ListenerTimer& operator=(const ListenerTimer&) = delete;
+        };
+
+        /**
+         * @brief Call the listener at a position of the callbacks, which must not have been removed.
+         * @return Value returned by the listener.
+         */
+        template <typename... Args>
+        decltype(auto) Call(std::size_t position, Args&&... args) const {
+            ListenerTimer timer(*this, position);
+            return _storage.Callbacks()[position](std::forward<Args>(args)...);
+        }
+
+        /// @return Callables of the listeners in dispatch order, cleared by dispatching when expired.
+        Callback* Callbacks() const {
+            return _storage.Callbacks();
+        }
+
+        /// @return Number of callbacks, including removed entries but not the listeners added during a dispatch.
+        std::size_t CallbackCount() const {
+            return _storage.Size();
+        }
+
+        /// @return Allocator of the list.
+        Allocator GetAllocator() const {
+            return Allocator(_storage.GetAllocator());
+        }
+
+        /// @return The extra state, allocated on first use.
+        Extras& GetExtras() {
+            if (_extras == nullptr) {
+                ExtrasAllocator allocator(GetAllocator());
+                Extras* extras = std::allocator_traits<ExtrasAllocator>::allocate(allocator, 1);
+                _extras = ::new (static_cast<void*>(extras)) Extras(GetAllocator());
+            }
+            return *_extras;
+        }
+
+        void FreeExtras() {
+            if (_extras != nullptr) {
+                ExtrasAllocator allocator(GetAllocator());
+                _extras->~Extras();
+                std::allocator_traits<ExtrasAllocator>::deallocate(allocator, _extras, 1);
+                _extras = nullptr;
+            }
+        }
+
+        /// @return true if removal by identity goes through the identity index.
+        bool HasIndex() const {
+            return _extras != nullptr && !_extras->index.empty();
+        }
+
+        /// @return true if the listener at a position of the callbacks is weak and its instance expired.
+        bool IsExpired(std::size_t position) const {
+            return (_storage.Flags()[position] & WeakFlag) != 0
+                && _extras->lifetimes[_storage.Listeners()[position].slot].expired();
+        }
+
+        /**
+         * @brief Check whether the listener at a position of the callbacks must be called by a dispatch.
+         *
+         * Clears the callback of a weak listener whose instance expired, so that the next dispatches
+         * skip it without checking again.
+         */
+        bool IsLive(std::size_t position) const {
+            Callback& callback = _storage.Callbacks()[position];
+            if (!callback)
+                return false;
+            if (!IsExpired(position))
+                return true;
+            callback = Callback();
+            ++_extras->expiredCount;
+            return false;
+        }
+
+        /// @return Number of listeners added during the dispatch in progress.
+        std::size_t PendingSize() const {
+            return _extras != nullptr ? _extras->pending.size() : 0;
+        }
+
+        /// @return Listener at a position of the logical list, made of the listeners of the storage followed by the pending ones.
+        Listener& ListenerAt(std::size_t position) {
+            return position < _storage.Size() ? _storage.Listeners()[position] : _extras->pending[position - _storage.Size()];
+        }
+
+        /// @copydoc ListenerAt
+        const Listener& ListenerAt(std::size_t position) const {
+            return position < _storage.Size() ? _storage.Listeners()[position] : _extras->pending[position - _storage.Size()];
+        }
+
+        /// @return Callback at a position of the logical list, made of the callbacks of the storage followed by the pending ones.
+        Callback& CallbackAt(std::size_t position) {
+            return position < _storage.Size() ? _storage.Callbacks()[position] : _extras->pendingCallbacks[position - _storage.Size()];
+        }
+
+        /// @return Flags at a position of the logical list, made of the flags of the storage followed by the pending ones.
+        std::uint8_t& FlagsAt(std::size_t position) {
+            return position < _storage.Size() ? _storage.Flags()[position] : _extras->pendingFlags[position - _storage.Size()];
+        }
+
+        /// @return Number of listeners in the logical list, including removed entries.
+        std::size_t LogicalSize() const {
+            return _storage.Size() + PendingSize();
+        }
+
+        /// @return true if listeners were added, or enough were removed, during the last dispatch.
+        bool HasDeferredWork() const {
+            return PendingSize() != 0 || (_removedCount != 0 && _removedCount * 2 >= _storage.Size());
+        }
+
+        /**
+         * @brief Move the listeners added during the dispatch to the dense array and compact it.
+         */
+        void ApplyDeferred() {
+            if (PendingSize() != 0) {
+                Vector<Listener>& pending = _extras->pending;
+                Vector<Callback>& pendingCallbacks = _extras->pendingCallbacks;
+                Vector<std::uint8_t>& pendingFlags = _extras->pendingFlags;
+                for (std::size_t i = 0; i < pending.size(); ++i) {
+                    if (pending[i].slot != Connection::InvalidIndex)
+                        Insert(pending[i], pendingCallbacks[i], pendingFlags[i]);
+                    else
+                        --_removedCount; // removed before joining the dense array
+                }
+                pending.clear();
+                pendingCallbacks.clear();
+                pendingFlags.clear();
+            }
+            CompactIfSparse();
+        }
+
+        /// Point the slots of the listeners from a position to the end back to their position.
+        void UpdateSlots(std::size_t position) {
+            const Listener* listeners = _storage.Listeners();
+            Slot* slots = _storage.Slots();
+            for (std::size_t i = position; i < _storage.Size(); ++i) {
+                if (listeners[i].slot != Connection::InvalidIndex)
+                    slots[listeners[i].slot].index = static_cast<std::uint32_t>(i);
+            }
+        }
+
+        /// @return Position after the listeners of higher or equal priority among the first count ones.
+        std::size_t PriorityEnd(std::size_t count, int priority) const {
+            const Listener* listeners = _storage.Listeners();
+            if (count == 0 || listeners[count - 1].priority >= priority)
+                return count;
+            return std::upper_bound(listeners, listeners + count, priority,
+                [](int priority, const Listener& other) { return priority > other.priority; }) - listeners;
+        }
+
+        /**
+         * @brief Insert a listener in the dense array after the listeners of higher or equal priority.
+         */
+        void Insert(const Listener& listener, const Callback& callback, std::uint8_t flags) {
+            const std::size_t position = PriorityEnd(_storage.Size(), listener.priority);
+            _storage.Insert(position, callback, flags, listener);
+            UpdateSlots(position);
+        }
+
+        /// @return A free slot, taken from the free list or appended to the slot map.
+        std::uint32_t AcquireSlot() {
+            std::uint32_t slot = _freeSlot;
+            if (slot != Connection::InvalidIndex)
+                _freeSlot = _storage.Slots()[slot].index;
+            else {
+                slot = static_cast<std::uint32_t>(_storage.SlotCount());
+                _storage.PushSlot({ 0, 0, nullptr });
+            }
+#ifdef TOOLBOX_EVENT_PROFILING
+            _profiler.Track(slot, _storage.Slots()[slot].generation);
+#endif
+            return slot;
+        }
+
+        /**
+         * @brief Insert a listener according to its priority and allocate its slot.
+         * @return Connection identifying the listener.
+         */
+        Connection Add(void* instancePtr, FunctionId functionId, Callback callback, int priority) {
+            if (_extras != nullptr && _extras->expiredCount != 0 && _extras->expiredCount * 2 >= _storage.Size())
+                PruneExpiredListeners();
+            std::uint32_t slot = AcquireSlot();
+            Listener listener = { instancePtr, functionId, slot, priority };
+            if (_dispatchDepth != 0) {
+                Extras& extras = GetExtras();
+                _storage.Slots()[slot].index = static_cast<std::uint32_t>(LogicalSize());
+                extras.pending.push_back(listener);
+                extras.pendingCallbacks.push_back(callback);
+                extras.pendingFlags.push_back(0);
+            }
+            else
+                Insert(listener, callback, 0);
+
+            if (HasIndex())
+                IndexInsert(slot, IdentityHash(instancePtr, functionId));
+            else if (LogicalSize() - _removedCount >= IdentityIndexThreshold)
+                RebuildIndex(IdentityIndexThreshold * 4);
+            return { this, slot, _storage.Slots()[slot].generation };
+        }
+
+        /**
+         * @brief Add a listener whose instance lifetime is observed.
+         * @return Connection identifying the listener.
+         */
+        Connection AddWeak(void* instancePtr, FunctionId functionId, Callback callback, int priority,
+            std::weak_ptr<const void> lifetime) {
+            Connection connection = Add(instancePtr, functionId, callback, priority);
+            Extras& extras = GetExtras();
+            if (extras.lifetimes.size() < _storage.SlotCount())
+                extras.lifetimes.resize(_storage.SlotCount());
+            extras.lifetimes[connection.index] = std::move(lifetime);
+            FlagsAt(_storage.Slots()[connection.index].index) |= WeakFlag;
+            ++extras.weakCount;
+            return connection;
+        }
+
+        /**
+         * @brief Append listeners of equal priority, moving them to their priority range in one pass.
+         *
+         * Must not be called while dispatching.
+         * @param makeListener Function of the index in the batch returning the instance pointer,
+         * function identity and callback of a listener.
+         */
+        template <typename MakeListener>
+        void AddBatch(std::size_t count, int priority, Connection* connections, const MakeListener& makeListener) {
+            const std::size_t first = _storage.Size();
+            _storage.Reserve(std::max(first, _storage.SlotCount()) + count);
+            for (std::size_t i = 0; i < count; ++i) {
+                const std::uint32_t slot = AcquireSlot();
+                auto [instancePtr, functionId, callback] = makeListener(i);
+                Slot& entry = _storage.Slots()[slot];
+                entry.index = static_cast<std::uint32_t>(first + i);
+                _storage.PushBack(callback, 0, { instancePtr, functionId, slot, priority });
+                if (connections != nullptr)
+                    connections[i] = { this, slot, entry.generation };
+            }
+
+            const std::size_t position = PriorityEnd(first, priority);
+            if (position != first) {
+                _storage.Rotate(position, first);
+                UpdateSlots(position);
+            }
+
+            const std::size_t live = LogicalSize() - _removedCount;
+            if (!HasIndex() && live < IdentityIndexThreshold)
+                return;
+            if (live * 2 > GetExtras().index.size())
+                RebuildIndex(std::max(live * 2, IdentityIndexThreshold * 4));
+            else {
+                const Listener* listeners = _storage.Listeners();
+                for (std::size_t i = position; i < position + count; ++i)
+                    IndexPlace(listeners[i].slot, IdentityHash(listeners[i].instancePtr, listeners[i].functionId));
+            }
+        }
+
+        /**
+         * @brief Remove the listener at the given position of the logical list.
+         */
+        void RemoveAt(std::size_t position) {
+            Listener& listener = ListenerAt(position);
+            Slot& slot = _storage.Slots()[listener.slot];
+            if (slot.scoped != nullptr) {
+                Detach(slot.scoped);
+                slot.scoped = nullptr;
+                --_scopedCount;
+            }
+            if (HasIndex())
+                IndexErase(listener.slot, IdentityHash(listener.instancePtr, listener.functionId));
+            if ((FlagsAt(position) & WeakFlag) != 0) {
+                _extras->lifetimes[listener.slot].reset();
+                FlagsAt(position) &= ~WeakFlag;
+                --_extras->weakCount;
+                if (!CallbackAt(position))
+                    --_extras->expiredCount;
+            }
+            ++slot.generation;
+            slot.index = _freeSlot;
+            _freeSlot = listener.slot;
+
+            CallbackAt(position) = Callback();
+            listener.slot = Connection::InvalidIndex;
+            ++_removedCount;
+        }
+
+        /**
+         * @brief Remove every listener matching the given instance and function identity.
+         */
+        void RemoveMatching(void* instancePtr, FunctionId functionId) {
+            if (HasIndex()) {
+                const std::uint32_t hash = IdentityHash(instancePtr, functionId);
+                for (std::uint32_t slot; (slot = IndexFind(instancePtr, functionId, hash)) != Connection::InvalidIndex;)
+                    RemoveAt(_storage.Slots()[slot].index);
+                CompactIfSparse();
+                return;
+            }
+            for (std::size_t i = 0; i < LogicalSize(); ++i) {
+                const Listener& listener = ListenerAt(i);
+                if (listener.slot != Connection::InvalidIndex
+                    && listener.instancePtr == instancePtr && listener.functionId == functionId)
+                    RemoveAt(i);
+            }
+            CompactIfSparse();
+        }
+
+        /// @return Hash of a listener identity.
+        static std::uint32_t IdentityHash(void* instancePtr, const FunctionId& functionId) {
+            std::uint64_t x = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(instancePtr)) * 0x9E3779B97F4A7C15ull
+                ^ functionId.Hash();
+            x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+            x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+            return static_cast<std::uint32_t>(x ^ (x >> 32));
+        }
+
+        /**
+         * @brief Refill the identity index from the registered listeners.
+         * @param minSize Minimum number of entries, rounded up to a power of two.
+         */
+        void RebuildIndex(std::size_t minSize) {
+            std::size_t size = 16;
+            while (size < minSize)
+                size *= 2;
+            GetExtras().index.assign(size, { Connection::InvalidIndex, 0 });
+            for (std::size_t i = 0; i < LogicalSize(); ++i) {
+                const Listener& listener = ListenerAt(i);
+                if (listener.slot != Connection::InvalidIndex)
+                    IndexPlace(listener.slot, IdentityHash(listener.instancePtr, listener.functionId));
+            }
+        }
+
+        /// Store an entry in the first free position of its probe sequence.
+        void IndexPlace(std::uint32_t slot, std::uint32_t hash) {
+            Vector<IndexEntry>& index = _extras->index;
+            const std::size_t mask = index.size() - 1;
+            std::size_t i = hash & mask;
+            while (index[i].slot != Connection::InvalidIndex)
+                i = (i + 1) & mask;
+            index[i] = { slot, hash };
+        }
+
+        /// Add a listener to the identity index, which is grown to stay at most half full.
+        void IndexInsert(std::uint32_t slot, std::uint32_t hash) {
+            const std::size_t count = LogicalSize() - _removedCount; // includes the new listener
+            if (count * 2 > _extras->index.size())
+                RebuildIndex(count * 2); // places the new listener too
+            else
+                IndexPlace(slot, hash);
+        }
+
+        /// Remove a listener from the identity index, shifting back the entries that probed past it.
+        void IndexErase(std::uint32_t slot, std::uint32_t hash) {
+            Vector<IndexEntry>& index = _extras->index;
+            const std::size_t mask = index.size() - 1;
+            std::size_t hole = hash & mask;
+            while (index[hole].slot != slot)
+                hole = (hole + 1) & mask;
+            for (std::size_t i = (hole + 1) & mask; index[i].slot != Connection::InvalidIndex; i = (i + 1) & mask) {
+                const std::size_t home = index[i].hash & mask;
+                // The entry may fill the hole unless its home lies cyclically in (hole, i].
+                if (((i - home) & mask) >= ((i - hole) & mask)) {
+                    index[hole] = index[i];
+                    hole = i;
+                }
+            }
+            index[hole] = { Connection::InvalidIndex, 0 };
+        }
+
+        /// @return Slot of a registered listener with the given identity, InvalidIndex if there is none.
+        std::uint32_t IndexFind(void* instancePtr, const FunctionId& functionId, std::uint32_t hash) {
+            const Vector<IndexEntry>& index = _extras->index;
+            const std::size_t mask = index.size() - 1;
+            for (std::size_t i = hash & mask; index[i].slot != Connection::InvalidIndex; i = (i + 1) & mask) {
+                if (index[i].hash != hash)
+                    continue;
+                const Listener& listener = ListenerAt(_storage.Slots()[index[i].slot].index);
+                if (listener.instancePtr == instancePtr && listener.functionId == functionId)
+                    return index[i].slot;
+            }
+            return Connection::InvalidIndex;
+        }
+
+        /**
+         * @brief Drop removed entries once they make up half of the dense array, unless dispatching.
+         */
+        void CompactIfSparse() {
+            if (_dispatchDepth != 0 || _removedCount * 2 < _storage.Size())
+                return;
+
+            Callback* callbacks = _storage.Callbacks();
+            Listener* listeners = _storage.Listeners();
+            Slot* slots = _storage.Slots();
+            std::uint8_t* flags = _storage.Flags();
+            std::size_t count = 0;
+            for (std::size_t i = 0; i < _storage.Size(); ++i) {
+                if (listeners[i].slot == Connection::InvalidIndex)
+                    continue;
+                slots[listeners[i].slot].index = static_cast<std::uint32_t>(count);
+                callbacks[count] = callbacks[i];
+                flags[count] = flags[i];
+                listeners[count++] = listeners[i];
+            }
+            _storage.Resize(count);
+            _removedCount = 0;
+        }
+
+        /// @return Number of listeners handled by each parallel task.
+        static std::size_t ParallelChunkSize(std::size_t count, std::size_t threadCount) {
+            return std::max<std::size_t>(1, count / (std::max<std::size_t>(threadCount, 1) * 4));
+        }
+
+        /**
+         * @brief Call every listener through invoke, running the parallel-safe ones on an executor.
+         *
+         * The parallel-safe listeners are split in chunks run as separate tasks, and the other listeners
+         * run in order as one more task. Returns once every listener was called.
+         */
+        template <typename Executor, typename Invoke>
+        void DispatchParallel(Executor& executor, const Invoke& invoke) const {
+            DispatchGuard guard(*this);
+            const std::size_t count = _storage.Size();
+            const std::size_t chunk = ParallelChunkSize(count, executor.ThreadCount());
+            const std::size_t chunks = (count + chunk - 1) / chunk;
+            // Listeners do not change the list here, so the arrays are not relocated
+            const Callback* callbacks = _storage.Callbacks();
+            const std::uint8_t* flags = _storage.Flags();
+            executor.ParallelFor(chunks + 1, [this, &invoke, chunk, count, callbacks, flags](std::size_t task) {
+                if (task == 0) {
+                    for (std::size_t i = 0; i < count; ++i) {
+                        if (callbacks[i] && (flags[i] & ParallelSafeFlag) == 0 && !IsExpired(i)) {
+                            ListenerTimer timer(*this, i);
+                            invoke(callbacks[i]);
+                        }
+                    }
+                    return;
+                }
+                const std::size_t end = std::min(count, task * chunk);
+                for (std::size_t i = (task - 1) * chunk; i < end; ++i) {
+                    if (callbacks[i] && (flags[i] & ParallelSafeFlag) != 0 && !IsExpired(i)) {
+                        ListenerTimer timer(*this, i);
+                        invoke(callbacks[i]);
+                    }
+                }
+            });
+        }
+
+        /**
+         * @brief Same as DispatchParallel, but returns without waiting for the listeners.
+         *
+         * The callbacks are copied, so the list may change as soon as the call returns. Weak listeners
+         * keep observing their instance: each task locks its lifetime around the call, and skips the
+         * listener if it expired in the meantime. invoke is moved into the tasks and must own
+         * everything it needs. These calls are not profiled.
+         */
+        template <typename Executor, typename Invoke>
+        void DispatchParallelDetached(Executor& executor, Invoke invoke) const {
+            /// Copy of a listener, with the lifetime of its instance if it is weak
+            struct DetachedListener {
+                Callback callback;
+                std::weak_ptr<const void> lifetime;
+                bool weak;
+            };
+            struct Batch {
+                std::vector<DetachedListener> serial;
+                std::vector<DetachedListener> parallel;
+                Invoke invoke;
+
+                void Call(const DetachedListener& listener) const {
+                    if (!listener.weak)
+                        invoke(listener.callback);
+                    else if (std::shared_ptr<const void> instance = listener.lifetime.lock())
+                        invoke(listener.callback);
+                }
+            };
+            auto batch = std::make_shared<Batch>(Batch{ {}, {}, std::move(invoke) });
+            const Callback* callbacks = _storage.Callbacks();
+            const std::uint8_t* flags = _storage.Flags();
+            for (std::size_t i = 0; i < _storage.Size(); ++i) {
+                if (!callbacks[i] || IsExpired(i))
+                    continue;
+                const bool weak = (flags[i] & WeakFlag) != 0;
+                ((flags[i] & ParallelSafeFlag) != 0 ? batch->parallel : batch->serial).push_back({ callbacks[i],
+                    weak ? _extras->lifetimes[_storage.Listeners()[i].slot] : std::weak_ptr<const void>(), weak });
+            }
+
+            if (!batch->serial.empty()) {
+                executor.Submit([batch] {
+                    for (const DetachedListener& listener : batch->serial)
+                        batch->Call(listener);
+                });
+            }
+            const std::size_t count = batch->parallel.size();
+            const std::size_t chunk = ParallelChunkSize(count, executor.ThreadCount());
+            for (std::size_t begin = 0; begin < count; begin += chunk) {
+                executor.Submit([batch, begin, end = std::min(count, begin + chunk)] {
+                    for (std::size_t i = begin; i < end; ++i)
+                        batch->Call(batch->parallel[i]);
+                });
+            }
+        }
+
+        /**
+         * @brief Empty the scoped connections owning listeners of this list.
+         */
+        void DetachAll() {
+            Slot* slots = _storage.Slots();
+            for (std::size_t i = 0; _scopedCount != 0 && i < _storage.SlotCount(); ++i) {
+                if (slots[i].scoped != nullptr) {
+                    Detach(slots[i].scoped);
+                    slots[i].scoped = nullptr;
+                    --_scopedCount;
+                }
+            }
+        }
+
+        /**
+         * @brief Point the scoped connections owning listeners of this list back to it.
+         */
+        void RetargetAll() {
+            const Slot* slots = _storage.Slots();
+            for (std::size_t i = 0, found = 0; found != _scopedCount && i < _storage.SlotCount(); ++i) {
+                if (slots[i].scoped != nullptr) {
+                    Retarget(slots[i].scoped, this);
+                    ++found;
+                }
+            }
+        }
+
+        /**
+         * @brief Forget the scoped connections of a copied slot map, they still belong to the source.
+         */
+        void ForgetScoped() {
+            Slot* slots = _storage.Slots();
+            for (std::size_t i = 0; i < _storage.SlotCount(); ++i)
+                slots[i].scoped = nullptr;
+            _scopedCount = 0;
+        }
+
+    private:
+
+        /// @copydoc ConnectionOwner::Disconnect
+        bool Disconnect(std::uint32_t index, std::uint32_t generation) override {
+            return RemoveListener({ this, index, generation });
+        }
+
+        /// @copydoc ConnectionOwner::Bind
+        bool Bind(std::uint32_t index, std::uint32_t generation, ScopedConnection* scoped) override {
+            if (!IsConnected({ this, index, generation }))
+                return false;
+            Slot& slot = _storage.Slots()[index];
+            if (scoped != nullptr && slot.scoped != nullptr)
+                return false;
+            _scopedCount += scoped != nullptr ? 1 : 0;
+            _scopedCount -= slot.scoped != nullptr ? 1 : 0;
+            slot.scoped = scoped;
+            return true;
+        }
+
+    public:
+
+        ListenerList() = default;
+
+        /// Creates an empty list whose storage comes from an allocator.
+        explicit ListenerList(const Allocator& allocator) : _storage(allocator) {}
+
+        /// Copies the listeners, the scoped connections keep owning the listeners of the source only.
+        ListenerList(const ListenerList& other)
+            : _storage(other._storage), _freeSlot(other._freeSlot), _removedCount(other._removedCount) {
+            if (other._extras != nullptr)
+                GetExtras() = *other._extras;
+            ForgetScoped();
+            ApplyDeferred();
+#ifdef TOOLBOX_EVENT_PROFILING
+            _profiler.TrackAll(_storage.Slots(), _storage.SlotCount());
+#endif
+#ifdef TOOLBOX_EVENT_TRACING
+            _traceName = other._traceName;
+#endif
+        }
+
+        /**
+         * @brief Moves the listeners, their scoped connections now point to this list.
+         *
+         * The source must not be dispatching, so it has no deferred work and nothing is allocated,
+         * except for the listener statistics when profiling.
+         */
+        ListenerList(ListenerList&& other) noexcept(NothrowMove)
+            : _storage(std::move(other._storage)), _freeSlot(std::exchange(other._freeSlot, Connection::InvalidIndex)),
+            _removedCount(std::exchange(other._removedCount, 0)), _scopedCount(std::exchange(other._scopedCount, 0)),
+            _extras(std::exchange(other._extras, nullptr)) {
+            RetargetAll();
+#ifdef TOOLBOX_EVENT_PROFILING
+            _profiler.TrackAll(_storage.Slots(), _storage.SlotCount());
+#endif
+#ifdef TOOLBOX_EVENT_TRACING
+            _traceName = other._traceName;
+#endif
+        }
+
+        ListenerList& operator=(const ListenerList& other) {
+            if (this != &other) {
+                DetachAll();
+                FreeExtras(); // with the current allocator, before it may be replaced
+                _storage = other._storage;
+                _freeSlot = other._freeSlot;
+                _removedCount = other._removedCount;
+                if (other._extras != nullptr)
+                    GetExtras() = *other._extras;
+                ForgetScoped();
+                ApplyDeferred();
+#ifdef TOOLBOX_EVENT_PROFILING
+                _profiler.TrackAll(_storage.Slots(), _storage.SlotCount());
+#endif
+#ifdef TOOLBOX_EVENT_TRACING
+                _traceName = other._traceName;
+#endif
+            }
+            return *this;
+        }
+
+        /// Neither list may be dispatching. Allocates only if the allocators differ and do not propagate.
+        ListenerList& operator=(ListenerList&& other) noexcept(NothrowMoveAssign) {
+            if (this != &other) {
+                DetachAll();
+                FreeExtras(); // with the current allocator, before it may be replaced
+                const bool stealExtras = std::allocator_traits<ExtrasAllocator>::propagate_on_container_move_assignment::value
+                    || GetAllocator() == other.GetAllocator();
+                if (stealExtras)
+                    _extras = std::exchange(other._extras, nullptr);
+                _storage = std::move(other._storage);
+                _freeSlot = std::exchange(other._freeSlot, Connection::InvalidIndex);
+                _removedCount = std::exchange(other._removedCount, 0);
+                _scopedCount = std::exchange(other._scopedCount, 0);
+                if (other._extras != nullptr) {
+                    GetExtras() = std::move(*other._extras);
+                    other.FreeExtras();
+                }
+                RetargetAll();
+#ifdef TOOLBOX_EVENT_PROFILING
+                _profiler.TrackAll(_storage.Slots(), _storage.SlotCount());
+#endif
+#ifdef TOOLBOX_EVENT_TRACING
+                _traceName = other._traceName;
+#endif
+            }
+            return *this;
+        }
+
+        /// Empties the scoped connections still owning listeners of this list.
+        ~ListenerList() {
+            DetachAll();
+            FreeExtras();
+        }
+
+        /**
+         * @brief Remove the listener identified by a connection in O(1).
+         * @param connection Connection returned by AddListener.
+         * @return false if the connection was stale or invalid.
+         */
+        bool RemoveListener(Connection connection) {
+            if (!IsConnected(connection))
+                return false;
+            RemoveAt(_storage.Slots()[connection.index].index);
+            CompactIfSparse();
+            return true;
+        }
+
+        /**
+         * @brief Declare whether a listener may run concurrently with the other listeners.
+         *
+         * Only parallel-safe listeners are spread across threads by TriggerParallel, the others keep
+         * running one after the other. Listeners are not parallel-safe by default.
+         * @param connection Connection returned by AddListener.
+         * @param parallelSafe Whether the listener is parallel-safe.
+         * @return false if the connection was stale or invalid.
+         */
+        bool SetParallelSafe(Connection connection, bool parallelSafe = true) {
+            if (!IsConnected(connection))
+                return false;
+            std::uint8_t& flags = FlagsAt(_storage.Slots()[connection.index].index);
+            flags = static_cast<std::uint8_t>(parallelSafe ? flags | ParallelSafeFlag : flags & ~ParallelSafeFlag);
+            return true;
+        }
+
+        /**
+         * @brief Check whether the listener identified by a connection is still registered.
+         * @param connection Connection returned by AddListener, connections of other events are never connected.
+         */
+        bool IsConnected(Connection connection) const {
+            return connection.owner == this && connection.index < _storage.SlotCount()
+                && _storage.Slots()[connection.index].generation == connection.generation;
+        }
+
+        /**
+         * @brief Removes all registered listeners.
+         */
+        void RemoveAllListeners() {
+            for (std::size_t i = 0; i < LogicalSize(); ++i) {
+                if (ListenerAt(i).slot != Connection::InvalidIndex)
+                    RemoveAt(i);
+            }
+            CompactIfSparse();
+        }
+
+        /**
+         * @brief Remove every method listener bound to an instance, in a single pass.
+         * @param instance Object whose methods were added.
+         * @return Number of removed listeners.
+         */
+        std::size_t RemoveAllListenersOf(const void* instance) {
+            std::size_t removed = 0;
+            for (std::size_t i = 0; i < LogicalSize(); ++i) {
+                const Listener& listener = ListenerAt(i);
+                if (listener.slot != Connection::InvalidIndex && listener.instancePtr == instance) {
+                    RemoveAt(i);
+                    ++removed;
+                }
+            }
+            CompactIfSparse();
+            return removed;
+        }
+
+        /**
+         * @brief Add the same method of many objects, with a single insertion pass.
+         *
+         * Equivalent to calling AddListener for each object in order, but the listeners are moved
+         * to their priority range together, and the storage grows once.
+         * @tparam T Class type of the instances.
+         * @tparam Method Method type accepted by AddListener.
+         * @param instances Pointers to the objects.
+         * @param count Number of objects.
+         * @param function Method to add for each object.
+         * @param priority Listeners with a higher priority are called first, equal ones in insertion order.
+         * @param connections If not nullptr, receives count connections identifying the listeners.
+         */
+        template <typename T, typename Method>
+        void AddListeners(T* const* instances, std::size_t count, Method function, int priority = 0,
+            Connection* connections = nullptr) {
+            static_assert(std::is_member_function_pointer<Method>::value, "AddListeners takes a method of T");
+            const FunctionId functionId = FunctionId::Of(function);
+            if (_dispatchDepth != 0) {
+                for (std::size_t i = 0; i < count; ++i) {
+                    Connection connection = Add(instances[i], functionId, Callback::FromMethod(instances[i], function), priority);
+                    if (connections != nullptr)
+                        connections[i] = connection;
+                }
+                return;
+            }
+            AddBatch(count, priority, connections, [&](std::size_t i) {
+                return std::make_tuple(static_cast<void*>(instances[i]), functionId, Callback::FromMethod(instances[i], function));
+            });
+        }
+
+        /**
+         * @brief Remove the same method of many objects, with a single compaction pass.
+         *
+         * Without the identity index, the listeners are scanned once against the sorted instances.
+         * @tparam T Class type of the instances.
+         * @tparam Method Method type accepted by RemoveListener.
+         * @param instances Pointers to the objects.
+         * @param count Number of objects.
+         * @param function Method to remove for each object.
+         */
+        template <typename T, typename Method>
+        void RemoveListeners(T* const* instances, std::size_t count, Method function) {
+            static_assert(std::is_member_function_pointer<Method>::value, "RemoveListeners takes a method of T");
+            const FunctionId functionId = FunctionId::Of(function);
+            if (HasIndex()) {
+                for (std::size_t i = 0; i < count; ++i) {
+                    const std::uint32_t hash = IdentityHash(instances[i], functionId);
+                    for (std::uint32_t slot; (slot = IndexFind(instances[i], functionId, hash)) != Connection::InvalidIndex;)
+                        RemoveAt(_storage.Slots()[slot].index);
+                }
+            }
+            else {
+                Vector<const void*> sorted(instances, instances + count, GetAllocator());
+                std::sort(sorted.begin(), sorted.end(), std::less<const void*>());
+                for (std::size_t i = 0; i < LogicalSize(); ++i) {
+                    const Listener& listener = ListenerAt(i);
+                    if (listener.slot != Connection::InvalidIndex && listener.functionId == functionId
+                        && std::binary_search(sorted.begin(), sorted.end(), listener.instancePtr, std::less<const void*>()))
+                        RemoveAt(i);
+                }
+            }
+            CompactIfSparse();
+        }
+
+        /**
+         * @brief Remove the listeners identified by many connections, with a single compaction pass.
+         * @param connections Connections returned by AddListener, stale ones are ignored.
+         * @param count Number of connections.
+         * @return Number of removed listeners.
+         */
+        std::size_t RemoveListeners(const Connection* connections, std::size_t count) {
+            std::size_t removed = 0;
+            for (std::size_t i = 0; i < count; ++i) {
+                if (IsConnected(connections[i])) {
+                    RemoveAt(_storage.Slots()[connections[i].index].index);
+                    ++removed;
+                }
+            }
+            CompactIfSparse();
+            return removed;
+        }
+
+        /**
+         * @brief Add a method of an object owned by a std::shared_ptr, as a weak listener.
+         *
+         * The event does not keep the object alive: once it is destroyed, the listener is skipped and
+         * later pruned. The object must not be destroyed by another thread while the event dispatches.
+         * @tparam T Class type of the instance.
+         * @tparam Method Method type accepted by the other AddListener overloads.
+         * @param instance Object, only observed.
+         * @param function Method to call.
+         * @param priority Listeners with a higher priority are called first, equal ones in insertion order.
+         * @return Connection identifying the listener.
+         */
+        template <typename T, typename Method>
+        Connection AddListener(const std::shared_ptr<T>& instance, Method function, int priority = 0) {
+            static_assert(std::is_member_function_pointer<Method>::value, "A shared instance takes a method of T");
+            return AddWeak(instance.get(), FunctionId::Of(function), Callback::FromMethod(instance.get(), function),
+                priority, instance);
+        }
+
+        /**
+         * @brief Add a method of an object whose lifetime is tracked by a LifetimeToken, as a weak listener.
+         *
+         * Once the token is destroyed or reset, the listener is skipped and later pruned.
+         * @tparam T Class type of the instance.
+         * @tparam Method Method type accepted by the other AddListener overloads.
+         * @param instance Object, usually the one owning the token.
+         * @param function Method to call.
+         * @param lifetime Token expiring with the object.
+         * @param priority Listeners with a higher priority are called first, equal ones in insertion order.
+         * @return Connection identifying the listener.
+         */
+        template <typename T, typename Method>
+        Connection AddListener(T* instance, Method function, const LifetimeToken& lifetime, int priority = 0) {
+            static_assert(std::is_member_function_pointer<Method>::value, "A tracked instance takes a method of T");
+            return AddWeak(instance, FunctionId::Of(function), Callback::FromMethod(instance, function),
+                priority, lifetime.Watch());
+        }
+
+        /**
+         * @brief Remove a method of an object owned by a std::shared_ptr.
+         * @param instance Object of the method.
+         * @param function Method to remove.
+         */
+        template <typename T, typename Method>
+        void RemoveListener(const std::shared_ptr<T>& instance, Method function) {
+            static_assert(std::is_member_function_pointer<Method>::value, "A shared instance takes a method of T");
+            RemoveMatching(instance.get(), FunctionId::Of(function));
+        }
+
+        /**
+         * @brief Remove the weak listeners whose object expired now. Otherwise they are only removed
+         * by adding a listener once dispatching found them to make up half of the list. Does nothing
+         * while dispatching.
+         * @return Number of removed listeners.
+         */
+        std::size_t PruneExpiredListeners() {
+            if (_extras == nullptr || _extras->weakCount == 0 || _dispatchDepth != 0)
+                return 0;
+            std::size_t removed = 0;
+            for (std::size_t i = 0; i < _storage.Size(); ++i) {
+                if ((_storage.Flags()[i] & WeakFlag) != 0 && (!_storage.Callbacks()[i] || IsExpired(i))) {
+                    RemoveAt(i);
+                    ++removed;
+                }
+            }
+            CompactIfSparse();
+            return removed;
+        }
+
+#ifdef TOOLBOX_EVENT_PROFILING
+        /**
+         * @brief Copy the dispatch statistics recorded since the listeners were added or ResetProfile.
+         *
+         * Copied and moved-to events start with empty statistics.
+         * @return Statistics of the event and of its listeners, in dispatch order.
+         */
+        EventProfile Profile() const {
+            EventProfile profile = _profiler.Dispatches();
+            for (std::size_t i = 0; i < LogicalSize(); ++i) {
+                const Listener& listener = ListenerAt(i);
+                if (listener.slot == Connection::InvalidIndex)
+                    continue;
+                Connection connection = { const_cast<ListenerList*>(this), listener.slot, _storage.Slots()[listener.slot].generation };
+                profile.listeners.push_back(_profiler.Listener(connection, listener.instancePtr,
+                    listener.functionId.Address(), listener.priority));
+            }
+            return profile;
+        }
+
+        /**
+         * @brief Clear the dispatch statistics of the event and of its listeners.
+         */
+        void ResetProfile() {
+            _profiler.Clear();
+        }
+#endif
+
+#ifdef TOOLBOX_EVENT_TRACING
+        /**
+         * @brief Name the spans recorded for this event by EventTracer, "Event" by default.
+         * Copies of the event, constructed or assigned, take its name.
+         * @param name Name, which must outlive the event and its copies (usually a string literal).
+         */
+        void SetTraceName(const char* name) {
+            _traceName = name;
+        }
+#endif
+    };
+
+}
@@ -0,0 +1,305 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @file ListenerStorage.h
+ * @brief Single buffer holding the parallel arrays of a listener list.
+ */
+
+namespace event_detail {
+
+    /// Buffer of the elements stored in the object itself, empty without inline capacity.
+    template <std::size_t Bytes, std::size_t Alignment>
+    struct InlineBuffer {
+        alignas(Alignment) std::byte bytes[Bytes];
+
+        std::byte* Get() { return bytes; }
+    };
+
+    template <std::size_t Alignment>
+    struct InlineBuffer<0, Alignment> {
+        std::byte* Get() { return nullptr; }
+    };
+
+    /// Types shared by the bases and the members of ListenerStorage.
+    template <typename Callback, typename Listener, typename Slot>
+    struct ListenerStorageLayout {
+        /// Alignment of the buffer, suitable for every array
+        static constexpr std::size_t Alignment = std::max({ alignof(Callback), alignof(Listener), alignof(Slot) });
+
+        /// Bytes taken by one element of each array
+        static constexpr std::size_t ElementBytes = sizeof(Callback) + sizeof(Listener) + sizeof(Slot) + 1;
+
+        /// Unit of the heap buffer, so that it is aligned whatever the allocator
+        struct alignas(Alignment) Block {
+            std::byte bytes[Alignment];
+        };
+    };
+
+    /**
+     * @brief Callbacks, flags, listener bookkeeping and slot map of a listener list, sharing one
+     * header and one buffer.
+     *
+     * The callbacks, the flag bytes and the listeners are parallel arrays of Size() elements, the
+     * slots an array of SlotCount() elements. The four arrays have the same capacity and are laid out
+     * one after the other in a single allocation, callbacks first and flags last, so that dispatching
+     * only walks the callbacks and the flags. With N > 0, the first N elements of each array are
+     * stored in the object itself. The elements must be trivially copyable: they are relocated with
+     * memcpy and never destroyed. Growing relocates the arrays, so pointers to them must be fetched
+     * again after anything that may add a slot, such as a listener call.
+     *
+     * @tparam Callback Hot element, read by dispatch.
+     * @tparam Listener Cold element, parallel to the callbacks.
+     * @tparam Slot Element of the slot map.
+     * @tparam N Number of elements of each array stored inline.
+     * @tparam Allocator Allocator of the heap buffer, rebound to an aligned block type.
+     */
+    template <typename Callback, typename Listener, typename Slot, std::size_t N, typename Allocator>
+    class ListenerStorage
+        : private std::allocator_traits<Allocator>::template rebind_alloc<typename ListenerStorageLayout<Callback, Listener, Slot>::Block>, // empty base for stateless allocators
+        private InlineBuffer<N * ListenerStorageLayout<Callback, Listener, Slot>::ElementBytes,
+            ListenerStorageLayout<Callback, Listener, Slot>::Alignment> {
+
+        static_assert(std::is_trivially_copyable<Callback>::value && std::is_trivially_copyable<Listener>::value
+            && std::is_trivially_copyable<Slot>::value, "Listener storage elements are relocated with memcpy");
+        static_assert(sizeof(Callback) % alignof(Listener) == 0 && (sizeof(Callback) + sizeof(Listener)) % alignof(Slot) == 0,
+            "Each array must stay aligned after the previous ones");
+
+        using Layout = ListenerStorageLayout<Callback, Listener, Slot>;
+        using Block = typename Layout::Block;
+        using BlockAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Block>;
+        using Traits = std::allocator_traits<BlockAllocator>;
+        using Buffer = InlineBuffer<N * Layout::ElementBytes, Layout::Alignment>;
+
+        /// @return Number of blocks holding the given number of elements of each array.
+        static std::size_t BlockCount(std::size_t capacity) {
+            return (capacity * Layout::ElementBytes + sizeof(Block) - 1) / sizeof(Block);
+        }
+
+        std::byte* _data;
+        std::uint32_t _size = 0;
+        std::uint32_t _slotCount = 0;
+        std::uint32_t _capacity = N;
+
+        std::byte* InlineData() {
+            return Buffer::Get();
+        }
+
+        bool IsInline() const {
+            return _data == const_cast<ListenerStorage*>(this)->InlineData();
+        }
+
+        BlockAllocator& Alloc() {
+            return *this;
+        }
+
+        /// Copy the arrays to a buffer laid out for the given capacity.
+        void CopyTo(std::byte* data, std::size_t capacity) const {
+            if (_size != 0) {
+                std::memcpy(data, Callbacks(), _size * sizeof(Callback));
+                std::memcpy(data + capacity * sizeof(Callback), Listeners(), _size * sizeof(Listener));
+                std::memcpy(data + capacity * (sizeof(Callback) + sizeof(Listener) + sizeof(Slot)), Flags(), _size);
+            }
+            if (_slotCount != 0)
+                std::memcpy(data + capacity * (sizeof(Callback) + sizeof(Listener)), Slots(), _slotCount * sizeof(Slot));
+        }
+
+        /// Move the arrays to a heap buffer of at least the given capacity.
+        void Grow(std::size_t minCapacity) {
+            std::size_t capacity = std::max<std::size_t>({ minCapacity, std::size_t(_capacity) * 2, 4 });
+            std::byte* data = reinterpret_cast<std::byte*>(Traits::allocate(Alloc(), BlockCount(capacity)));
+            CopyTo(data, capacity);
+            FreeHeap();
+            _data = data;
+            _capacity = static_cast<std::uint32_t>(capacity);
+        }
+
+        void FreeHeap() {
+            if (!IsInline())
+                Traits::deallocate(Alloc(), reinterpret_cast<Block*>(_data), BlockCount(_capacity));
+        }
+
+        /// Free the heap buffer, going back to the inline one.
+        void Reset() {
+            FreeHeap();
+            _data = InlineData();
+            _capacity = static_cast<std::uint32_t>(N);
+        }
+
+        /// Copy the elements of another storage, this one being empty.
+        void CopyFrom(const ListenerStorage& other) {
+            Reserve(std::max(other._size, other._slotCount));
+            other.CopyTo(_data, _capacity);
+            _size = other._size;
+            _slotCount = other._slotCount;
+        }
+
+        /// Take the elements of another storage, which is left empty. This one must be empty and inline.
+        void Steal(ListenerStorage& other) {
+            if (other.IsInline() || Alloc() != other.Alloc()) {
+                CopyFrom(other);
+                other._size = 0;
+                other._slotCount = 0;
+                return;
+            }
+            _data = std::exchange(other._data, other.InlineData());
+            _size = std::exchange(other._size, 0);
+            _slotCount = std::exchange(other._slotCount, 0);
+            _capacity = std::exchange(other._capacity, static_cast<std::uint32_t>(N));
+        }
+
+    public:
+
+        ListenerStorage() : _data(InlineData()) {}
+
+        explicit ListenerStorage(const Allocator& allocator) : BlockAllocator(allocator), _data(InlineData()) {}
+
+        ListenerStorage(const ListenerStorage& other)
+            : BlockAllocator(Traits::select_on_container_copy_construction(other)), _data(InlineData()) {
+            CopyFrom(other);
+        }
+
+        ListenerStorage(ListenerStorage&& other) noexcept
+            : BlockAllocator(std::move(other.Alloc())), _data(InlineData()) {
+            Steal(other); // the allocators are equal, so nothing is allocated
+        }
+
+        ListenerStorage& operator=(const ListenerStorage& other) {
+            if (this != &other) {
+                _size = 0;
+                _slotCount = 0;
+                if constexpr (Traits::propagate_on_container_copy_assignment::value) {
+                    if (Alloc() != other.Alloc())
+                        Reset();
+                    Alloc() = other.Alloc();
+                }
+                CopyFrom(other);
+            }
+            return *this;
+        }
+
+        ListenerStorage& operator=(ListenerStorage&& other) noexcept(Traits::propagate_on_container_move_assignment::value
+            || Traits::is_always_equal::value) {
+            if (this != &other) {
+                _size = 0;
+                _slotCount = 0;
+                // Free the heap buffer if the one of other is taken instead, or if the allocator is replaced
+                if (Alloc() == other.Alloc() ? !other.IsInline() : Traits::propagate_on_container_move_assignment::value)
+                    Reset();
+                if constexpr (Traits::propagate_on_container_move_assignment::value)
+                    Alloc() = std::move(other.Alloc());
+                Steal(other);
+            }
+            return *this;
+        }
+
+        ~ListenerStorage() {
+            FreeHeap();
+        }
+
+        /// @return Allocator of the heap buffer.
+        BlockAllocator GetAllocator() const {
+            return *this;
+        }
+
+        /// @return Callbacks, writable through a const storage so that dispatching can clear them.
+        Callback* Callbacks() const {
+            return reinterpret_cast<Callback*>(_data);
+        }
+
+        Listener* Listeners() {
+            return reinterpret_cast<Listener*>(_data + std::size_t(_capacity) * sizeof(Callback));
+        }
+
+        const Listener* Listeners() const {
+            return reinterpret_cast<const Listener*>(_data + std::size_t(_capacity) * sizeof(Callback));
+        }
+
+        Slot* Slots() {
+            return reinterpret_cast<Slot*>(_data + std::size_t(_capacity) * (sizeof(Callback) + sizeof(Listener)));
+        }
+
+        const Slot* Slots() const {
+            return reinterpret_cast<const Slot*>(_data + std::size_t(_capacity) * (sizeof(Callback) + sizeof(Listener)));
+        }
+
+        /// @return Flag bytes of the listeners, parallel to the callbacks.
+        std::uint8_t* Flags() {
+            return reinterpret_cast<std::uint8_t*>(_data + std::size_t(_capacity) * (sizeof(Callback) + sizeof(Listener) + sizeof(Slot)));
+        }
+
+        const std::uint8_t* Flags() const {
+            return reinterpret_cast<const std::uint8_t*>(_data + std::size_t(_capacity) * (sizeof(Callback) + sizeof(Listener) + sizeof(Slot)));
+        }
+
+        /// @return Number of callbacks, flags and listeners.
+        std::size_t Size() const {
+            return _size;
+        }
+
+        /// @return Number of slots.
+        std::size_t SlotCount() const {
+            return _slotCount;
+        }
+
+        /// Make room for the given number of elements in each array.
+        void Reserve(std::size_t capacity) {
+            if (capacity > _capacity)
+                Grow(capacity);
+        }
+
+        /// Append a callback, its flags and its listener.
+        void PushBack(const Callback& callback, std::uint8_t flags, const Listener& listener) {
+            Insert(_size, callback, flags, listener);
+        }
+
+        /// Insert a callback, its flags and its listener at a position, shifting the following ones.
+        void Insert(std::size_t position, const Callback& callback, std::uint8_t flags, const Listener& listener) {
+            if (_size == _capacity) {
+                const Callback callbackCopy(callback); // the arguments may be elements of this storage
+                const Listener listenerCopy(listener);
+                Grow(std::size_t(_size) + 1);
+                Insert(position, callbackCopy, flags, listenerCopy);
+                return;
+            }
+            Callback* callbacks = Callbacks();
+            Listener* listeners = Listeners();
+            std::uint8_t* flagBytes = Flags();
+            std::memmove(static_cast<void*>(callbacks + position + 1), callbacks + position, (_size - position) * sizeof(Callback));
+            std::memmove(static_cast<void*>(listeners + position + 1), listeners + position, (_size - position) * sizeof(Listener));
+            std::memmove(flagBytes + position + 1, flagBytes + position, _size - position);
+            ::new (static_cast<void*>(callbacks + position)) Callback(callback);
+            ::new (static_cast<void*>(listeners + position)) Listener(listener);
+            flagBytes[position] = flags;
+            ++_size;
+        }
+
+        /// Move the elements from first to the end in front of the elements from position, in the parallel arrays.
+        void Rotate(std::size_t position, std::size_t first) {
+            std::rotate(Callbacks() + position, Callbacks() + first, Callbacks() + _size);
+            std::rotate(Listeners() + position, Listeners() + first, Listeners() + _size);
+            std::rotate(Flags() + position, Flags() + first, Flags() + _size);
+        }
+
+        /// Shrink the callbacks, flags and listeners to count elements.
+        void Resize(std::size_t count) {
+            _size = static_cast<std::uint32_t>(std::min<std::size_t>(count, _size));
+        }
+
+        /// Append a slot.
+        void PushSlot(const Slot& slot) {
+            if (_slotCount == _capacity)
+                Grow(std::size_t(_slotCount) + 1);
+            ::new (static_cast<void*>(Slots() + _slotCount)) Slot(slot);
+            ++_slotCount;
+        }
+    };
+
+}
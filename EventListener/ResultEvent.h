@@ -0,0 +1,348 @@
+#pragma once
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Delegate.h"
+#include "ListenerList.h"
+
+/**
+ * @file ResultEvent.h
+ * @brief Event whose listeners return a value, combined by a collector that can stop the dispatch.
+ */
+
+/**
+ * @brief Collectors combining the values returned by the listeners of a ResultEvent.
+ *
+ * A collector is default constructible and provides:
+ * - Result: type returned by ResultEvent::Trigger.
+ * - bool Collect(R value): receives the value of a listener, returns false to stop the dispatch.
+ * - Result GetResult(): combined value once the dispatch is over.
+ */
+namespace collect {
+
+    /**
+     * @brief Keep the first value that converts to true (non-empty optional, non-null pointer...)
+     * and stop there. The result is a default constructed R if no listener returned one.
+     */
+    template <typename R>
+    class FirstNonEmpty {
+        R _value{};
+    public:
+        using Result = R;
+
+        bool Collect(R value) {
+            if (!static_cast<bool>(value))
+                return true;
+            _value = std::move(value);
+            return false;
+        }
+
+        Result GetResult() { return std::move(_value); }
+    };
+
+    /**
+     * @brief true if every listener returned true, stops at the first false.
+     */
+    template <typename R = bool>
+    class AllOf {
+        bool _value = true;
+    public:
+        using Result = bool;
+
+        bool Collect(const R& value) {
+            _value = static_cast<bool>(value);
+            return _value;
+        }
+
+        Result GetResult() const { return _value; }
+    };
+
+    /**
+     * @brief true if a listener returned true, stops at the first true.
+     *
+     * With listeners returning whether they handled the event, this stops the dispatch at the
+     * listener consuming it.
+     */
+    template <typename R = bool>
+    class AnyOf {
+        bool _value = false;
+    public:
+        using Result = bool;
+
+        bool Collect(const R& value) {
+            _value = static_cast<bool>(value);
+            return !_value;
+        }
+
+        Result GetResult() const { return _value; }
+    };
+
+    /**
+     * @brief Sum of all the values.
+     */
+    template <typename R>
+    class Sum {
+        R _value{};
+    public:
+        using Result = R;
+
+        bool Collect(const R& value) {
+            _value += value;
+            return true;
+        }
+
+        Result GetResult() { return std::move(_value); }
+    };
+
+    /**
+     * @brief Every value, in call order.
+     */
+    template <typename R>
+    class Vector {
+        std::vector<R> _values;
+    public:
+        using Result = std::vector<R>;
+
+        bool Collect(R value) {
+            _values.push_back(std::move(value));
+            return true;
+        }
+
+        Result GetResult() { return std::move(_values); }
+    };
+
+    /**
+     * @brief Value of the last listener called, a default constructed R if there was none.
+     */
+    template <typename R>
+    class Last {
+        R _value{};
+    public:
+        using Result = R;
+
+        bool Collect(R value) {
+            _value = std::move(value);
+            return true;
+        }
+
+        Result GetResult() { return std::move(_value); }
+    };
+
+}
+
+namespace event_detail {
+
+    /// R() function pointer, or a pointer to an undefined type when the event takes no argument.
+    template <typename R, typename... Types>
+    using IgnoringResultFunction = std::conditional_t<sizeof...(Types) == 0, NoOverload<0>*, R(*)()>;
+
+    /// R(T::*)() member pointer, or a pointer to an undefined type when the event takes no argument.
+    template <typename R, typename T, typename... Types>
+    using IgnoringResultMethod = std::conditional_t<sizeof...(Types) == 0, NoOverload<0>*, R(T::*)()>;
+
+    /// Function taking the arguments as passed by Trigger, or a pointer to an undefined type if that is R(Types...).
+    template <typename R, typename... Types>
+    using ParamResultFunction = std::conditional_t<std::is_same<void(Param<Types>...), void(Types...)>::value,
+        NoOverload<1>*, R(*)(Param<Types>...)>;
+
+    /// Method taking the arguments as passed by Trigger, or a pointer to an undefined type if that is R(Types...).
+    template <typename R, typename T, typename... Types>
+    using ParamResultMethod = std::conditional_t<std::is_same<void(Param<Types>...), void(Types...)>::value,
+        NoOverload<1>*, R(T::*)(Param<Types>...)>;
+
+}
+
+template <typename Signature>
+class ResultEvent;
+
+/**
+ * @brief Event whose listeners return a value, combined by a collector chosen at each Trigger.
+ *
+ * Listeners are registered, ordered and removed exactly as with Event. Trigger passes each returned
+ * value to a collector, which can stop the dispatch early, for instance when a listener consumed
+ * the event:
+ * @code
+ * ResultEvent<bool(const KeyPress&)> onKey;
+ * bool handled = onKey.Trigger<collect::AnyOf<bool>>(key);
+ * @endcode
+ *
+ * @tparam R Type returned by the listeners.
+ * @tparam Types Argument types passed to the listeners.
+ */
+template <typename R, typename... Types>
+class ResultEvent<R(Types...)> : public event_detail::ListenerList<Delegate<R(event_detail::Param<Types>...)>> {
+    static_assert(!std::is_void<R>::value, "Use Event for listeners returning void");
+
+    /// Internal non-allocating function wrapper type, receiving the arguments as passed by Trigger
+    using Callback = Delegate<R(event_detail::Param<Types>...)>;
+
+    using Base = event_detail::ListenerList<Callback>;
+
+public:
+
+    using Base::AddListener;
+    using Base::RemoveListener;
+
+    /**
+     * @brief Add a free function with the exact signature R(Types...).
+     * @param function Pointer to the function to be added.
+     * @param priority Listeners with a higher priority are called first, equal ones in insertion order.
+     * @return Connection identifying the listener.
+     */
+    Connection AddListener(R(*function)(Types...), int priority = 0) {
+        return this->Add(nullptr, event_detail::FunctionId::Of(function), Callback::FromFunction(function), priority);
+    }
+
+    /**
+     * @brief Add a free function taking the arguments as Trigger passes them.
+     * @param function Pointer to the function to be added.
+     * @param priority Listeners with a higher priority are called first, equal ones in insertion order.
+     * @return Connection identifying the listener.
+     */
+    Connection AddListener(event_detail::ParamResultFunction<R, Types...> function, int priority = 0) {
+        return this->Add(nullptr, event_detail::FunctionId::Of(function), Callback::FromFunction(function), priority);
+    }
+
+    /**
+     * @brief Add a free function with no parameters, ignoring the passed arguments.
+     * @param function Pointer to a function R().
+     * @param priority Listeners with a higher priority are called first, equal ones in insertion order.
+     * @return Connection identifying the listener.
+     */
+    Connection AddListener(event_detail::IgnoringResultFunction<R, Types...> function, int priority = 0) {
+        return this->Add(nullptr, event_detail::FunctionId::Of(function), Callback::FromFunction(function), priority); // arguments ignored
+    }
+
+    /**
+     * @brief Remove a free function with signature R(Types...).
+     * @param function Pointer to the function to be removed.
+     */
+    void RemoveListener(R(*function)(Types...)) {
+        this->RemoveMatching(nullptr, event_detail::FunctionId::Of(function));
+    }
+
+    /**
+     * @brief Remove a free function taking the arguments as Trigger passes them.
+     * @param function Pointer to the function to be removed.
+     */
+    void RemoveListener(event_detail::ParamResultFunction<R, Types...> function) {
+        this->RemoveMatching(nullptr, event_detail::FunctionId::Of(function));
+    }
+
+    /**
+     * @brief Remove a free function with signature R().
+     * @param function Pointer to the function to be removed.
+     */
+    void RemoveListener(event_detail::IgnoringResultFunction<R, Types...> function) {
+        this->RemoveMatching(nullptr, event_detail::FunctionId::Of(function));
+    }
+
+    /**
+     * @brief Add a member function with the exact signature R(T::*)(Types...).
+     *
+     * @tparam T Class type of the instance.
+     * @param instance Pointer to the object.
+     * @param function Pointer to the member method.
+     * @param priority Listeners with a higher priority are called first, equal ones in insertion order.
+     * @return Connection identifying the listener.
+     */
+    template <typename T>
+    Connection AddListener(T* instance, R(T::* function)(Types...), int priority = 0) {
+        return this->Add(instance, event_detail::FunctionId::Of(function), Callback::FromMethod(instance, function), priority);
+    }
+
+    /**
+     * @brief Add a member function taking the arguments as Trigger passes them.
+     *
+     * @tparam T Class type of the instance.
+     * @param instance Pointer to the object.
+     * @param function Pointer to the member method.
+     * @param priority Listeners with a higher priority are called first, equal ones in insertion order.
+     * @return Connection identifying the listener.
+     */
+    template <typename T>
+    Connection AddListener(T* instance, event_detail::ParamResultMethod<R, T, Types...> function, int priority = 0) {
+        return this->Add(instance, event_detail::FunctionId::Of(function), Callback::FromMethod(instance, function), priority);
+    }
+
+    /**
+     * @brief Add a member function with no parameters, arguments are ignored.
+     *
+     * @tparam T Class type of the instance.
+     * @param instance Pointer to the object.
+     * @param function Pointer to the method R(T::*)().
+     * @param priority Listeners with a higher priority are called first, equal ones in insertion order.
+     * @return Connection identifying the listener.
+     */
+    template <typename T>
+    Connection AddListener(T* instance, event_detail::IgnoringResultMethod<R, T, Types...> function, int priority = 0) {
+        return this->Add(instance, event_detail::FunctionId::Of(function), Callback::FromMethod(instance, function), priority); // arguments ignored
+    }
+
+    /**
+     * @brief Remove a member method with signature R(T::*)(Types...).
+     *
+     * @tparam T Class type of the instance.
+     * @param instance Pointer to the object.
+     * @param function Pointer to the method.
+     */
+    template <typename T>
+    void RemoveListener(T* instance, R(T::* function)(Types...)) {
+        this->RemoveMatching(instance, event_detail::FunctionId::Of(function));
+    }
+
+    /**
+     * @brief Remove a member method taking the arguments as Trigger passes them.
+     *
+     * @tparam T Class type of the instance.
+     * @param instance Pointer to the object.
+     * @param function Pointer to the method.
+     */
+    template <typename T>
+    void RemoveListener(T* instance, event_detail::ParamResultMethod<R, T, Types...> function) {
+        this->RemoveMatching(instance, event_detail::FunctionId::Of(function));
+    }
+
+    /**
+     * @brief Remove a member method with no parameters.
+     *
+     * @tparam T Class type of the instance.
+     * @param instance Pointer to the object.
+     * @param function Pointer to the method R(T::*)().
+     */
+    template <typename T>
+    void RemoveListener(T* instance, event_detail::IgnoringResultMethod<R, T, Types...> function) {
+        this->RemoveMatching(instance, event_detail::FunctionId::Of(function));
+    }
+
+    /**
+     * @brief Trigger the event, passing each returned value to a collector.
+     *
+     * @param collector Collector receiving the values, it stops the dispatch by returning false.
+     * @param args Arguments to forward to the listeners.
+     * @return false if the collector stopped the dispatch before the last listener.
+     */
+    template <typename Collector>
+    bool TriggerWith(Collector& collector, event_detail::Param<Types>... args) const {
+        typename Base::DispatchGuard guard(*this);
+        for (std::size_t i = 0, count = this->CallbackCount(); i < count; ++i) {
+            if (this->IsLive(i) && !collector.Collect(this->Call(i, args...)))
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Trigger the event and combine the returned values with a new collector.
+     *
+     * @tparam Collector Collector type, such as collect::AnyOf<bool> or collect::Sum<int>.
+     * @param args Arguments to forward to the listeners.
+     * @return The collector result.
+     */
+    template <typename Collector>
+    typename Collector::Result Trigger(event_detail::Param<Types>... args) const {
+        Collector collector;
+        TriggerWith(collector, args...);
+        return collector.GetResult();
+    }
+};
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include "Delegate.h"
+
+/**
+ * @file StaticEvent.h
+ * @brief Event whose listeners are fixed at compile time.
+ */
+
+template <typename Signature, auto... Listeners>
+class StaticEvent;
+
+/**
+ * @brief Event whose listeners are template arguments, called directly with no storage.
+ *
+ * Triggering calls every listener in order through its compile-time address, so the calls can be
+ * inlined. Listeners are free functions or static member functions, taking either the event
+ * arguments or no argument:
+ * @code
+ * using OnFrame = StaticEvent<void(float), &Physics::Step, &Audio::Update>;
+ * OnFrame::Trigger(deltaTime);
+ * @endcode
+ *
+ * @tparam Types Argument types passed to the listeners.
+ * @tparam Listeners Listeners, called in the given order.
+ */
+template <typename... Types, auto... Listeners>
+class StaticEvent<void(Types...), Listeners...> {
+
+    template <auto Listener>
+    static constexpr bool IsAccepted() {
+        return std::is_invocable<decltype(Listener), event_detail::Param<Types>...>::value
+            || std::is_invocable<decltype(Listener)>::value;
+    }
+
+    static_assert((IsAccepted<Listeners>() && ...),
+        "Listeners must take arguments constructible from the event ones, or no argument");
+
+    template <auto Listener>
+    static void Call(event_detail::Param<Types>... args) {
+        if constexpr (std::is_invocable<decltype(Listener), event_detail::Param<Types>...>::value)
+            Listener(args...);
+        else {
+            ((void)args, ...); // arguments ignored
+            Listener();
+        }
+    }
+
+public:
+
+    /// Same event with more listeners, called after the current ones.
+    template <auto... More>
+    using With = StaticEvent<void(Types...), Listeners..., More...>;
+
+    /// Number of listeners
+    static constexpr std::size_t ListenerCount = sizeof...(Listeners);
+
+    /**
+     * @brief Call every listener, in order.
+     * @param args Arguments to forward to the listeners.
+     */
+    static void Trigger(event_detail::Param<Types>... args) {
+        (Call<Listeners>(args...), ...);
+    }
+};
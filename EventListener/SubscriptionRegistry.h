@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include "Connection.h"
+
+/**
+ * @file SubscriptionRegistry.h
+ * @brief Registry of the listeners added for each object, across events.
+ */
+
+/**
+ * @brief Opt-in record of the events each object subscribed to, so that one call unsubscribes it
+ * from all of them.
+ *
+ * Listeners added through the registry are owned by scoped connections grouped per object, so
+ * destroying or moving an event is safe: its scoped connections are emptied or follow it.
+ * Unsubscribing an object removes each of its listeners in O(1), without scanning any event.
+ *
+ * Typically one registry is owned per world or level, and objects call UnsubscribeAll(this) when
+ * destroyed. Like Event, a registry is not thread-safe.
+ * @code
+ * registry.Subscribe(onDamage, this, &Player::OnDamage);
+ * registry.Subscribe(onFrame, this, &Player::OnFrame);
+ * ...
+ * registry.UnsubscribeAll(this);
+ * @endcode
+ */
+class SubscriptionRegistry {
+    std::unordered_map<const void*, ConnectionGroup> _groups;
+
+public:
+
+    SubscriptionRegistry() = default;
+    SubscriptionRegistry(SubscriptionRegistry&&) = default;
+    SubscriptionRegistry& operator=(SubscriptionRegistry&&) = default;
+
+    /**
+     * @brief Add a method listener to an event and record it for its instance.
+     * @param event Event to add the listener to.
+     * @param instance Object of the method.
+     * @param args Method, and optionally priority, as taken by the AddListener of the event.
+     * @return Connection identifying the listener.
+     */
+    template <typename EventType, typename T, typename... Args>
+    Connection Subscribe(EventType& event, T* instance, Args&&... args) {
+        Connection connection = event.AddListener(instance, std::forward<Args>(args)...);
+        Track(instance, connection);
+        return connection;
+    }
+
+    /**
+     * @brief Record a listener added by other means, to be removed with the other listeners of an object.
+     *
+     * The listener must not already be owned by a ScopedConnection.
+     * @param instance Object the listener belongs to.
+     * @param connection Connection returned by AddListener.
+     */
+    void Track(const void* instance, Connection connection) {
+        _groups[instance].Add(connection);
+    }
+
+    /**
+     * @brief Remove every listener recorded for an object, from every event.
+     * @param instance Object to unsubscribe.
+     * @return false if nothing was recorded for the object.
+     */
+    bool UnsubscribeAll(const void* instance) {
+        auto found = _groups.find(instance);
+        if (found == _groups.end())
+            return false;
+        _groups.erase(found); // the group removes the listeners when destroyed
+        return true;
+    }
+
+    /// @return Number of objects with recorded listeners.
+    std::size_t InstanceCount() const {
+        return _groups.size();
+    }
+};
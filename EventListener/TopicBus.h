@@ -0,0 +1,349 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "Event.h"
+
+/**
+ * @file TopicBus.h
+ * @brief Bus routing events by topic name, with interned topics and wildcard subscriptions.
+ */
+
+/**
+ * @brief Publish/subscribe bus holding one Event<Types...> per topic name.
+ *
+ * Topics are dot-separated names such as "net.tcp.open". Each topic is interned once into a dense
+ * TopicId, and publishing by id is an array access. Publishing by name hashes the name once and
+ * never allocates: it probes an open-addressing table, or, after Freeze, a minimal perfect hash
+ * built over the known topics, which always takes a single probe.
+ *
+ * Subscriptions may use patterns where a "*" segment matches exactly one segment, or one or more
+ * segments when it is the last one: "net.*" receives "net.connect" and "net.tcp.open", "*.error"
+ * receives "net.error" but not "net.tcp.error". Publishing calls the listeners of the topic, then
+ * those of the matching patterns in subscription order.
+ *
+ * Like Event, a bus is not thread-safe.
+ *
+ * @tparam Types Argument types passed to the listeners.
+ */
+template <typename... Types>
+class TopicBus {
+public:
+
+    /// Dense id of an interned topic
+    using TopicId = std::uint32_t;
+
+    /// Id of no topic
+    static constexpr TopicId InvalidTopic = UINT32_MAX;
+
+private:
+
+    struct Topic {
+        std::string name;
+        std::uint64_t hash;
+        std::unique_ptr<Event<Types...>> event;
+        std::vector<std::uint32_t> patterns; ///< Indices in _patterns of the patterns matching the topic
+    };
+
+    struct Pattern {
+        std::string pattern;
+        std::unique_ptr<Event<Types...>> event;
+    };
+
+    std::vector<Topic> _topics;
+    std::vector<Pattern> _patterns;
+
+    /// Open-addressing table of topic ids, power of two sized, kept at most half full
+    std::vector<TopicId> _table;
+
+    /// Minimal perfect hash built by Freeze: seed per bucket, and topic id per position
+    std::vector<std::uint32_t> _seeds;
+    std::vector<TopicId> _perfect;
+    bool _frozen = false;
+
+    static std::uint64_t Hash(std::string_view text) {
+        std::uint64_t hash = 14695981039346656037ull; // FNV-1a
+        for (char c : text) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    /// Derive an independent well-mixed value from a hash and a seed (splitmix64 finalizer).
+    static std::uint64_t Mix(std::uint64_t hash, std::uint32_t seed) {
+        std::uint64_t x = hash + (static_cast<std::uint64_t>(seed) + 1) * 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    static bool HasWildcard(std::string_view topic) {
+        return topic.find('*') != std::string_view::npos;
+    }
+
+    /// Split the first segment off a dot-separated name.
+    static std::string_view NextSegment(std::string_view& name) {
+        std::size_t dot = name.find('.');
+        std::string_view segment = name.substr(0, dot);
+        name = dot == std::string_view::npos ? std::string_view() : name.substr(dot + 1);
+        return segment;
+    }
+
+    TopicId Probe(std::string_view topic, std::uint64_t hash) const {
+        if (_table.empty())
+            return InvalidTopic;
+        const std::size_t mask = _table.size() - 1;
+        for (std::size_t i = static_cast<std::size_t>(hash) & mask;; i = (i + 1) & mask) {
+            TopicId id = _table[i];
+            if (id == InvalidTopic || (_topics[id].hash == hash && _topics[id].name == topic))
+                return id;
+        }
+    }
+
+    void InsertInTable(TopicId id) {
+        const std::size_t mask = _table.size() - 1;
+        std::size_t i = static_cast<std::size_t>(_topics[id].hash) & mask;
+        while (_table[i] != InvalidTopic)
+            i = (i + 1) & mask;
+        _table[i] = id;
+    }
+
+    void GrowTable() {
+        _table.assign(std::max<std::size_t>(16, _table.size() * 2), InvalidTopic);
+        for (TopicId id = 0; id < _topics.size(); ++id)
+            InsertInTable(id);
+    }
+
+    Event<Types...>& PatternEvent(std::string_view pattern) {
+        for (Pattern& existing : _patterns) {
+            if (existing.pattern == pattern)
+                return *existing.event;
+        }
+        const std::uint32_t index = static_cast<std::uint32_t>(_patterns.size());
+        _patterns.push_back({ std::string(pattern), std::make_unique<Event<Types...>>() });
+        for (Topic& topic : _topics) {
+            if (Matches(pattern, topic.name))
+                topic.patterns.push_back(index);
+        }
+        return *_patterns.back().event;
+    }
+
+    Event<Types...>* FindEvent(std::string_view topicOrPattern) {
+        if (HasWildcard(topicOrPattern)) {
+            for (Pattern& pattern : _patterns) {
+                if (pattern.pattern == topicOrPattern)
+                    return pattern.event.get();
+            }
+            return nullptr;
+        }
+        TopicId id = Find(topicOrPattern);
+        return id != InvalidTopic ? _topics[id].event.get() : nullptr;
+    }
+
+public:
+
+    TopicBus() = default;
+    TopicBus(TopicBus&&) = default;
+    TopicBus& operator=(TopicBus&&) = default;
+
+    /**
+     * @brief Check whether a topic matches a subscription pattern.
+     * @param pattern Topic name, possibly with "*" segments.
+     * @param topic Topic name without wildcard.
+     */
+    static bool Matches(std::string_view pattern, std::string_view topic) {
+        for (;;) {
+            if (pattern.empty())
+                return topic.empty();
+            if (topic.empty())
+                return false;
+            std::string_view expected = NextSegment(pattern);
+            std::string_view actual = NextSegment(topic);
+            if (expected == "*" && pattern.empty())
+                return true; // trailing wildcard takes the remaining segments
+            if (expected != "*" && expected != actual)
+                return false;
+        }
+    }
+
+    /**
+     * @brief Intern a topic name, creating the topic if needed.
+     *
+     * Adding a topic after Freeze drops the perfect hash until Freeze is called again.
+     * @param topic Topic name, without wildcard.
+     * @return Id of the topic.
+     */
+    TopicId Intern(std::string_view topic) {
+        const std::uint64_t hash = Hash(topic);
+        TopicId id = Probe(topic, hash);
+        if (id != InvalidTopic)
+            return id;
+
+        id = static_cast<TopicId>(_topics.size());
+        Topic entry{ std::string(topic), hash, std::make_unique<Event<Types...>>(), {} };
+        for (std::uint32_t i = 0; i < _patterns.size(); ++i) {
+            if (Matches(_patterns[i].pattern, topic))
+                entry.patterns.push_back(i);
+        }
+        _topics.push_back(std::move(entry));
+        if (_topics.size() * 2 > _table.size())
+            GrowTable();
+        else
+            InsertInTable(id);
+        _frozen = false;
+        return id;
+    }
+
+    /**
+     * @brief Find an interned topic, without allocating.
+     * @param topic Topic name.
+     * @return Id of the topic, InvalidTopic if it was never interned.
+     */
+    TopicId Find(std::string_view topic) const {
+        const std::uint64_t hash = Hash(topic);
+        if (!_frozen)
+            return Probe(topic, hash);
+        if (_perfect.empty())
+            return InvalidTopic;
+        std::uint32_t seed = _seeds[hash % _seeds.size()];
+        TopicId id = _perfect[Mix(hash, seed) % _perfect.size()];
+        return _topics[id].hash == hash && _topics[id].name == topic ? id : InvalidTopic;
+    }
+
+    /**
+     * @brief Build a minimal perfect hash over the interned topics, so that Find takes a single probe.
+     *
+     * Uses hash and displace: topics are spread over buckets of about two, and each bucket, largest
+     * first, gets the first seed placing all its topics on free positions of a table with exactly one
+     * position per topic.
+     * @return false if no perfect hash was found (colliding 64-bit hashes), Find keeps probing then.
+     */
+    bool Freeze() {
+        const std::size_t count = _topics.size();
+        std::vector<std::vector<TopicId>> buckets((count + 1) / 2 + 1);
+        for (TopicId id = 0; id < count; ++id)
+            buckets[_topics[id].hash % buckets.size()].push_back(id);
+        std::vector<std::uint32_t> order(buckets.size());
+        for (std::uint32_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(),
+            [&buckets](std::uint32_t a, std::uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+        std::vector<std::uint32_t> seeds(buckets.size(), 0);
+        std::vector<TopicId> perfect(count, InvalidTopic);
+        std::vector<std::size_t> positions;
+        for (std::uint32_t bucket : order) {
+            const std::vector<TopicId>& ids = buckets[bucket];
+            if (ids.empty())
+                break;
+            std::uint32_t seed = 0;
+            for (;; ++seed) {
+                if (seed == (1u << 24))
+                    return false;
+                positions.clear();
+                bool placed = true;
+                for (TopicId id : ids) {
+                    std::size_t position = Mix(_topics[id].hash, seed) % count;
+                    if (perfect[position] != InvalidTopic
+                        || std::find(positions.begin(), positions.end(), position) != positions.end()) {
+                        placed = false;
+                        break;
+                    }
+                    positions.push_back(position);
+                }
+                if (placed)
+                    break;
+            }
+            seeds[bucket] = seed;
+            for (std::size_t i = 0; i < ids.size(); ++i)
+                perfect[positions[i]] = ids[i];
+        }
+
+        _seeds = std::move(seeds);
+        _perfect = std::move(perfect);
+        _frozen = true;
+        return true;
+    }
+
+    /// @return true if Find uses the perfect hash built by Freeze.
+    bool IsFrozen() const {
+        return _frozen;
+    }
+
+    /// @return Number of interned topics.
+    std::size_t TopicCount() const {
+        return _topics.size();
+    }
+
+    /// @return Name of an interned topic.
+    const std::string& Name(TopicId topic) const {
+        return _topics[topic].name;
+    }
+
+    /**
+     * @brief Event of a topic or pattern, created if needed.
+     * @param topicOrPattern Topic name, or pattern with "*" segments.
+     */
+    Event<Types...>& EventOf(std::string_view topicOrPattern) {
+        if (HasWildcard(topicOrPattern))
+            return PatternEvent(topicOrPattern);
+        return *_topics[Intern(topicOrPattern)].event;
+    }
+
+    /**
+     * @brief Add a listener to a topic or pattern, with any Event<Types...>::AddListener arguments.
+     * @param topicOrPattern Topic name, or pattern with "*" segments.
+     * @return Connection identifying the listener.
+     */
+    template <typename... Args>
+    Connection Subscribe(std::string_view topicOrPattern, Args&&... args) {
+        return EventOf(topicOrPattern).AddListener(std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Remove listeners from a topic or pattern, with any Event<Types...>::RemoveListener arguments.
+     * @param topicOrPattern Topic name, or pattern with "*" segments.
+     */
+    template <typename... Args>
+    void Unsubscribe(std::string_view topicOrPattern, Args&&... args) {
+        if (Event<Types...>* event = FindEvent(topicOrPattern))
+            event->RemoveListener(std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Trigger an interned topic, then the patterns matching it.
+     * @param topic Id returned by Intern.
+     * @param args Arguments to forward to the listeners.
+     */
+    void Publish(TopicId topic, event_detail::Param<Types>... args) const {
+        // Indexed loops: listeners may intern topics or subscribe patterns, growing the vectors.
+        _topics[topic].event->Trigger(args...);
+        for (std::size_t i = 0; i < _topics[topic].patterns.size(); ++i)
+            _patterns[_topics[topic].patterns[i]].event->Trigger(args...);
+    }
+
+    /**
+     * @brief Trigger a topic by name, then the patterns matching it, without allocating.
+     *
+     * A topic that was never interned only reaches the matching patterns, which are then tested one by one.
+     * @param topic Topic name, without wildcard.
+     * @param args Arguments to forward to the listeners.
+     */
+    void Publish(std::string_view topic, event_detail::Param<Types>... args) const {
+        TopicId id = Find(topic);
+        if (id != InvalidTopic) {
+            Publish(id, args...);
+            return;
+        }
+        for (std::size_t i = 0; i < _patterns.size(); ++i) {
+            if (Matches(_patterns[i].pattern, topic))
+                _patterns[i].event->Trigger(args...);
+        }
+    }
+};
@@ -0,0 +1,212 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @file WorkStealingPool.h
+ * @brief Thread pool where idle workers steal tasks from the queues of busy ones.
+ */
+
+/**
+ * @brief Fixed-size thread pool with one task queue per worker and work stealing.
+ *
+ * A task submitted from a worker goes to the back of that worker's queue, and workers take their
+ * own tasks from the back (most recent, still hot in cache). A worker whose queue is empty steals
+ * from the front of the other queues. Tasks submitted from other threads are spread round-robin.
+ *
+ * ParallelFor lets the calling thread take part in the work, so it can also be called from a task.
+ */
+class WorkStealingPool {
+public:
+
+    /// Unit of work run by the pool
+    using Task = std::function<void()>;
+
+private:
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::vector<std::thread> _threads;
+
+    std::atomic<std::size_t> _queued{ 0 };     ///< Tasks waiting in the queues
+    std::atomic<std::size_t> _nextWorker{ 0 }; ///< Round-robin position for external submissions
+    std::atomic<bool> _stop{ false };
+
+    std::mutex _sleepMutex;
+    std::condition_variable _wake;
+
+    /// Pool whose worker runs on the calling thread, if any
+    static const WorkStealingPool*& CurrentWorkerPool() {
+        static thread_local const WorkStealingPool* pool = nullptr;
+        return pool;
+    }
+
+    /// Index of the worker running on the calling thread
+    static std::size_t& CurrentWorkerIndex() {
+        static thread_local std::size_t index = SIZE_MAX;
+        return index;
+    }
+
+    /// @return Index of the worker running on the calling thread, or SIZE_MAX outside this pool.
+    std::size_t WorkerOfCaller() const {
+        return CurrentWorkerPool() == this ? CurrentWorkerIndex() : SIZE_MAX;
+    }
+
+    bool TryPop(std::size_t workerIndex, Task& task) {
+        Worker& worker = *_workers[workerIndex];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty())
+            return false;
+        task = std::move(worker.tasks.back());
+        worker.tasks.pop_back();
+        return true;
+    }
+
+    bool TrySteal(std::size_t workerIndex, Task& task) {
+        Worker& worker = *_workers[workerIndex];
+        std::unique_lock<std::mutex> lock(worker.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || worker.tasks.empty())
+            return false;
+        task = std::move(worker.tasks.front());
+        worker.tasks.pop_front();
+        return true;
+    }
+
+    /**
+     * @brief Run one queued task, from the caller's own queue first, stolen otherwise.
+     * @return false if no task could be found.
+     */
+    bool TryRunOne() {
+        if (_queued.load(std::memory_order_acquire) == 0)
+            return false;
+
+        const std::size_t count = _workers.size();
+        const std::size_t own = WorkerOfCaller();
+        const std::size_t start = own != SIZE_MAX ? own : _nextWorker.load(std::memory_order_relaxed) % count;
+        Task task;
+        bool found = own != SIZE_MAX && TryPop(own, task);
+        for (std::size_t i = 0; !found && i < count; ++i) {
+            std::size_t victim = (start + i) % count;
+            if (victim != own)
+                found = TrySteal(victim, task);
+        }
+        if (!found)
+            return false;
+
+        _queued.fetch_sub(1, std::memory_order_acq_rel);
+        task();
+        return true;
+    }
+
+    void Run(std::size_t workerIndex) {
+        CurrentWorkerPool() = this;
+        CurrentWorkerIndex() = workerIndex;
+        for (;;) {
+            if (TryRunOne())
+                continue;
+            std::unique_lock<std::mutex> lock(_sleepMutex);
+            _wake.wait(lock, [this] {
+                return _stop.load(std::memory_order_acquire) || _queued.load(std::memory_order_acquire) != 0;
+            });
+            if (_stop.load(std::memory_order_acquire) && _queued.load(std::memory_order_acquire) == 0)
+                return;
+        }
+    }
+
+public:
+
+    /**
+     * @brief Start the worker threads.
+     * @param threadCount Number of workers, defaults to the number of hardware threads.
+     */
+    explicit WorkStealingPool(std::size_t threadCount = std::max(1u, std::thread::hardware_concurrency())) {
+        threadCount = std::max<std::size_t>(threadCount, 1);
+        for (std::size_t i = 0; i < threadCount; ++i)
+            _workers.push_back(std::make_unique<Worker>());
+        for (std::size_t i = 0; i < threadCount; ++i)
+            _threads.emplace_back([this, i] { Run(i); });
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /**
+     * @brief Run the tasks still queued, then stop and join the workers.
+     */
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(_sleepMutex);
+            _stop.store(true, std::memory_order_release);
+        }
+        _wake.notify_all();
+        for (std::thread& thread : _threads)
+            thread.join();
+    }
+
+    /// @return Number of worker threads.
+    std::size_t ThreadCount() const {
+        return _workers.size();
+    }
+
+    /**
+     * @brief Queue a task, run later by any worker.
+     * @param task Task to run.
+     */
+    void Submit(Task task) {
+        std::size_t target = WorkerOfCaller();
+        if (target == SIZE_MAX)
+            target = _nextWorker.fetch_add(1, std::memory_order_relaxed) % _workers.size();
+        {
+            // Counted before being pushed so that the count never drops below zero when popped.
+            std::lock_guard<std::mutex> lock(_sleepMutex);
+            _queued.fetch_add(1, std::memory_order_release);
+        }
+        {
+            Worker& worker = *_workers[target];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.tasks.push_back(std::move(task));
+        }
+        _wake.notify_one();
+    }
+
+    /**
+     * @brief Call function(i) for every i in [0, count) and wait for all the calls to return.
+     *
+     * The calling thread runs index 0 and then helps with any queued task while waiting.
+     * The function must not throw.
+     * @param count Number of calls.
+     * @param function Function taking the index of the call.
+     */
+    template <typename Function>
+    void ParallelFor(std::size_t count, const Function& function) {
+        if (count == 0)
+            return;
+
+        std::atomic<std::size_t> remaining{ count - 1 };
+        for (std::size_t i = 1; i < count; ++i) {
+            Submit([&function, &remaining, i] {
+                function(i);
+                remaining.fetch_sub(1, std::memory_order_acq_rel);
+            });
+        }
+
+        function(0);
+        while (remaining.load(std::memory_order_acquire) != 0) {
+            if (!TryRunOne())
+                std::this_thread::yield();
+        }
+    }
+};
@@ -0,0 +1,328 @@
+/**
+ * @file EventBenchmark.cpp
+ * @brief Throughput and allocation benchmarks for Event.
+ *
+ * Measures Trigger as the number of listeners grows, free functions against member methods,
+ * the cost of AddListener and RemoveListener, and the effect of the payload size, with
+ * StaticEvent as the baseline of a dispatch without storage, and EventBus routing.
+ * Every case reports ns per operation and heap allocations per operation.
+ *
+ * Usage: EventBenchmark [--json <file>] [--max-listeners <n>] [--min-time-ms <ms>]
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Event.h"
+#include "EventBus.h"
+#include "StaticEvent.h"
+
+// ---- Allocation counting ----
+
+namespace {
+    std::atomic<std::uint64_t> allocationCount{ 0 };
+}
+
+// Kept out of line so that GCC does not pair the inlined malloc/free with new/delete and warn.
+#if defined(__GNUC__)
+#define BENCHMARK_NOINLINE __attribute__((noinline))
+#else
+#define BENCHMARK_NOINLINE
+#endif
+
+BENCHMARK_NOINLINE void* operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size ? size : 1))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+BENCHMARK_NOINLINE void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+BENCHMARK_NOINLINE void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+namespace {
+
+    // ---- Harness ----
+
+    using Clock = std::chrono::steady_clock;
+
+    /// Keeps the optimizer from discarding the work of the listeners
+    std::atomic<std::uint64_t> sink{ 0 };
+
+    /// Accumulated by the free function listeners with a plain add, like Receiver, and published to sink after each measurement
+    std::uint64_t freeTotal = 0;
+
+    struct Result {
+        std::string name;
+        std::size_t listeners;
+        std::size_t payloadBytes;
+        std::uint64_t operations;
+        double nsPerOperation;
+        double allocationsPerOperation;
+    };
+
+    struct Options {
+        const char* jsonPath = nullptr;
+        std::size_t maxListeners = 1000000;
+        double minTimeMs = 200.0;
+    };
+
+    Options options;
+    std::vector<Result> results;
+
+    void Report(const char* name, std::size_t listeners, std::size_t payloadBytes,
+        std::uint64_t operations, double elapsedNs, std::uint64_t allocations) {
+        Result result{ name, listeners, payloadBytes, operations,
+            elapsedNs / static_cast<double>(operations),
+            static_cast<double>(allocations) / static_cast<double>(operations) };
+        std::printf("%-24s listeners=%-8zu payload=%-5zu %12.2f ns/op %8.3f allocs/op\n",
+            result.name.c_str(), listeners, payloadBytes, result.nsPerOperation, result.allocationsPerOperation);
+        results.push_back(std::move(result));
+    }
+
+    /**
+     * @brief Run body(iterations) with a growing number of iterations until it lasts long enough, then report it.
+     * @param operationsPerIteration Number of operations done by one iteration of body.
+     */
+    template <typename Body>
+    void Measure(const char* name, std::size_t listeners, std::size_t payloadBytes,
+        std::uint64_t operationsPerIteration, const Body& body) {
+        body(1); // warm up
+        std::uint64_t iterations = 1;
+        for (;;) {
+            std::uint64_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+            Clock::time_point start = Clock::now();
+            body(iterations);
+            double elapsedNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            std::uint64_t allocations = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+            if (elapsedNs >= options.minTimeMs * 1e6 || iterations >= (1ull << 40)) {
+                sink.fetch_add(std::exchange(freeTotal, 0), std::memory_order_relaxed);
+                Report(name, listeners, payloadBytes, iterations * operationsPerIteration, elapsedNs, allocations);
+                return;
+            }
+            // Aim a bit past the minimum time, growing at most 100x per step.
+            double scale = elapsedNs > 0 ? options.minTimeMs * 1.2e6 / elapsedNs : 100.0;
+            iterations = static_cast<std::uint64_t>(static_cast<double>(iterations) * std::min(std::max(scale, 2.0), 100.0));
+        }
+    }
+
+    std::vector<std::size_t> ListenerCounts(std::size_t max) {
+        std::vector<std::size_t> counts;
+        for (std::size_t count = 1; count <= max; count *= 10)
+            counts.push_back(count);
+        return counts;
+    }
+
+    // ---- Listeners ----
+
+    void FreeListener(int value) {
+        freeTotal += static_cast<std::uint64_t>(value);
+    }
+
+    /**
+     * @brief Same work as FreeListener, kept out of line so that the calls of StaticEvent are not folded
+     * away and the baseline measures a direct call per listener.
+     */
+    BENCHMARK_NOINLINE void StaticListener(int value) {
+        freeTotal += static_cast<std::uint64_t>(value);
+    }
+
+    struct Receiver {
+        std::uint64_t total = 0;
+
+        void OnValue(int value) {
+            total += static_cast<std::uint64_t>(value);
+        }
+    };
+
+    template <std::size_t Size>
+    struct Payload {
+        std::array<unsigned char, Size> bytes{};
+    };
+
+    /// Takes the payload the way Trigger passes it: by value up to two pointers, by const reference above.
+    template <std::size_t Size>
+    void PayloadListener(event_detail::Param<Payload<Size>> payload) {
+        freeTotal += payload.bytes[0];
+    }
+
+    // ---- Cases ----
+
+    void BenchmarkTriggerFree() {
+        for (std::size_t count : ListenerCounts(options.maxListeners)) {
+            Event<int> event;
+            for (std::size_t i = 0; i < count; ++i)
+                event.AddListener(&FreeListener);
+            Measure("Trigger/free", count, sizeof(int), 1, [&event](std::uint64_t iterations) {
+                for (std::uint64_t i = 0; i < iterations; ++i)
+                    event.Trigger(1);
+            });
+        }
+    }
+
+    void BenchmarkTriggerMember() {
+        for (std::size_t count : ListenerCounts(options.maxListeners)) {
+            std::vector<Receiver> receivers(count);
+            Event<int> event;
+            for (Receiver& receiver : receivers)
+                event.AddListener(&receiver, &Receiver::OnValue);
+            Measure("Trigger/member", count, sizeof(int), 1, [&event](std::uint64_t iterations) {
+                for (std::uint64_t i = 0; i < iterations; ++i)
+                    event.Trigger(1);
+            });
+            for (const Receiver& receiver : receivers)
+                sink.fetch_add(receiver.total, std::memory_order_relaxed);
+        }
+    }
+
+    template <std::size_t... Indices>
+    void BenchmarkStaticEvent(std::index_sequence<Indices...>) {
+        using Static = StaticEvent<void(int), ((void)Indices, &StaticListener)...>;
+        Measure("Trigger/static", sizeof...(Indices), sizeof(int), 1, [](std::uint64_t iterations) {
+            for (std::uint64_t i = 0; i < iterations; ++i)
+                Static::Trigger(1);
+        });
+    }
+
+    void BenchmarkEventBus() {
+        EventBus bus;
+        bus.Subscribe<int>(&FreeListener);
+        bus.Subscribe<Payload<8>>(&PayloadListener<8>);
+        Measure("Publish/bus", 1, sizeof(int), 1, [&bus](std::uint64_t iterations) {
+            for (std::uint64_t i = 0; i < iterations; ++i)
+                bus.Publish(1);
+        });
+    }
+
+    void BenchmarkAddRemove() {
+        for (std::size_t count : ListenerCounts(options.maxListeners)) {
+            std::vector<Receiver> receivers(count);
+            std::vector<Connection> connections(count);
+            Event<int> event;
+            Measure("AddRemove/connection", count, 0, 2 * count, [&](std::uint64_t iterations) {
+                for (std::uint64_t i = 0; i < iterations; ++i) {
+                    for (std::size_t j = 0; j < count; ++j)
+                        connections[j] = event.AddListener(&receivers[j], &Receiver::OnValue);
+                    for (std::size_t j = 0; j < count; ++j)
+                        event.RemoveListener(connections[j]);
+                }
+            });
+            Measure("AddRemove/identity", count, 0, 2 * count, [&](std::uint64_t iterations) {
+                for (std::uint64_t i = 0; i < iterations; ++i) {
+                    for (std::size_t j = 0; j < count; ++j)
+                        event.AddListener(&receivers[j], &Receiver::OnValue);
+                    for (std::size_t j = 0; j < count; ++j)
+                        event.RemoveListener(&receivers[j], &Receiver::OnValue);
+                }
+            });
+        }
+    }
+
+    /// Create an event, add two listeners, trigger it and destroy it, as components embedding events do.
+    template <typename EventType>
+    void BenchmarkLifetime(const char* name) {
+        Receiver receivers[2];
+        Measure(name, 2, sizeof(int), 1, [&receivers](std::uint64_t iterations) {
+            for (std::uint64_t i = 0; i < iterations; ++i) {
+                EventType event;
+                event.AddListener(&receivers[0], &Receiver::OnValue);
+                event.AddListener(&receivers[1], &Receiver::OnValue);
+                event.Trigger(1);
+            }
+        });
+        sink.fetch_add(receivers[0].total + receivers[1].total, std::memory_order_relaxed);
+    }
+
+    template <std::size_t Size>
+    void BenchmarkPayload() {
+        constexpr std::size_t Listeners = 16;
+        Event<Payload<Size>> event;
+        for (std::size_t i = 0; i < Listeners; ++i)
+            event.AddListener(&PayloadListener<Size>);
+        Payload<Size> payload;
+        payload.bytes[0] = 1;
+        Measure("Trigger/payload", Listeners, Size, 1, [&](std::uint64_t iterations) {
+            for (std::uint64_t i = 0; i < iterations; ++i)
+                event.Trigger(payload);
+        });
+    }
+
+    // ---- Output ----
+
+    bool WriteJson(const char* path) {
+        std::FILE* file = std::fopen(path, "w");
+        if (!file)
+            return false;
+        std::fprintf(file, "{\n  \"benchmarks\": [\n");
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const Result& result = results[i];
+            std::fprintf(file,
+                "    {\"name\": \"%s\", \"listeners\": %zu, \"payload_bytes\": %zu, \"operations\": %llu, "
+                "\"ns_per_op\": %.3f, \"allocs_per_op\": %.6f}%s\n",
+                result.name.c_str(), result.listeners, result.payloadBytes,
+                static_cast<unsigned long long>(result.operations), result.nsPerOperation,
+                result.allocationsPerOperation, i + 1 < results.size() ? "," : "");
+        }
+        std::fprintf(file, "  ]\n}\n");
+        return std::fclose(file) == 0;
+    }
+
+    bool ParseArguments(int argc, char** argv) {
+        for (int i = 1; i < argc; ++i) {
+            bool hasValue = i + 1 < argc;
+            if (std::strcmp(argv[i], "--json") == 0 && hasValue)
+                options.jsonPath = argv[++i];
+            else if (std::strcmp(argv[i], "--max-listeners") == 0 && hasValue)
+                options.maxListeners = std::strtoull(argv[++i], nullptr, 10);
+            else if (std::strcmp(argv[i], "--min-time-ms") == 0 && hasValue)
+                options.minTimeMs = std::strtod(argv[++i], nullptr);
+            else
+                return false;
+        }
+        return true;
+    }
+
+}
+
+int main(int argc, char** argv) {
+    if (!ParseArguments(argc, argv)) {
+        std::fprintf(stderr, "Usage: %s [--json <file>] [--max-listeners <n>] [--min-time-ms <ms>]\n", argv[0]);
+        return 2;
+    }
+
+    BenchmarkTriggerFree();
+    BenchmarkTriggerMember();
+    BenchmarkStaticEvent(std::make_index_sequence<1>());
+    BenchmarkStaticEvent(std::make_index_sequence<10>());
+    BenchmarkStaticEvent(std::make_index_sequence<100>());
+    BenchmarkEventBus();
+    BenchmarkAddRemove();
+    BenchmarkLifetime<Event<int>>("Lifetime/event");
+    BenchmarkLifetime<SmallEvent<2, int>>("Lifetime/small");
+    BenchmarkPayload<8>();
+    BenchmarkPayload<64>();
+    BenchmarkPayload<256>();
+    BenchmarkPayload<1024>();
+
+    if (options.jsonPath && !WriteJson(options.jsonPath)) {
+        std::fprintf(stderr, "Cannot write %s\n", options.jsonPath);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+/**
+ * @file EventProfilingTests.cpp
+ * @brief Tests of the dispatch statistics recorded when TOOLBOX_EVENT_PROFILING is defined.
+ */
+
+#ifndef TOOLBOX_EVENT_PROFILING
+#define TOOLBOX_EVENT_PROFILING
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include "Event.h"
+#include "ResultEvent.h"
+
+/// Report a failed condition without stopping the test, unlike assert it is kept in release builds.
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            ++failures; \
+        } \
+    } while (false)
+
+namespace {
+
+    int failures = 0;
+
+    struct Fast {
+        int calls = 0;
+        void OnValue(int) { ++calls; }
+        int Identity(int value) { return value; }
+    };
+
+    struct Slow {
+        void OnValue(int) { std::this_thread::sleep_for(std::chrono::milliseconds(2)); }
+    };
+
+    void TestHistogramBuckets() {
+        for (std::uint64_t value : { 0ull, 7ull, 8ull, 15ull, 16ull, 17ull, 1000ull, 123456789ull, ~0ull }) {
+            std::size_t bucket = LatencyHistogram::BucketOf(value);
+            CHECK(bucket < LatencyHistogram::BucketCount);
+            CHECK(LatencyHistogram::BucketUpperBound(bucket) >= value);
+            CHECK(bucket == 0 || LatencyHistogram::BucketUpperBound(bucket - 1) < value);
+        }
+
+        LatencyHistogram histogram;
+        for (std::uint64_t value = 1; value <= 100; ++value)
+            histogram.Record(value);
+        CHECK(histogram.Count() == 100);
+        CHECK(histogram.Percentile(50) >= 50 && histogram.Percentile(50) < 57);
+        CHECK(histogram.Percentile(100) >= 100);
+    }
+
+    void TestListenerProfiles() {
+        Event<int> event;
+        Fast fast;
+        Slow slow;
+        event.AddListener(&fast, &Fast::OnValue);
+        Connection slowConnection = event.AddListener(&slow, &Slow::OnValue, -1);
+        for (int i = 0; i < 5; ++i)
+            event.Trigger(i);
+        event.TriggerMove(0);
+
+        EventProfile profile = event.Profile();
+        CHECK(profile.dispatches == 6);
+        CHECK(profile.listeners.size() == 2);
+        CHECK(profile.listeners[1].connection == slowConnection);
+        CHECK(profile.listeners[1].calls == 6);
+        CHECK(profile.listeners[1].latency.Percentile(50) >= 1000000);
+        CHECK(profile.listeners[0].calls == 6);
+        CHECK(profile.listeners[0].maxNs < profile.listeners[1].maxNs);
+
+        // A listener reusing a slot starts with empty statistics.
+        event.RemoveListener(slowConnection);
+        event.AddListener(&fast, &Fast::OnValue);
+        profile = event.Profile();
+        CHECK(profile.listeners.size() == 2);
+        CHECK(profile.listeners[1].calls == 0);
+
+        event.ResetProfile();
+        CHECK(event.Profile().dispatches == 0);
+        CHECK(event.Profile().listeners[0].calls == 0);
+    }
+
+    void TestResultEventProfile() {
+        Fast fast;
+        ResultEvent<int(int)> event;
+        event.AddListener(&fast, &Fast::Identity);
+        CHECK(event.Trigger<collect::Sum<int>>(3) == 3);
+        CHECK(event.Profile().listeners[0].calls == 1);
+    }
+
+}
+
+int main() {
+    TestHistogramBuckets();
+    TestListenerProfiles();
+    TestResultEventProfile();
+    std::printf("%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,867 @@
+/**
+ * @file EventTests.cpp
+ * @brief Functional tests of the event listener system and the work-stealing pool.
+ *
+ * Usage: EventTests [test name]
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "ConcurrentEvent.h"
+#include "Event.h"
+#include "EventBus.h"
+#include "EventChannel.h"
+#include "EventQueue.h"
+#include "ResultEvent.h"
+#include "StaticEvent.h"
+#include "SubscriptionRegistry.h"
+#include "TopicBus.h"
+#include "WorkStealingPool.h"
+
+/// Report a failed condition without stopping the test, unlike assert it is kept in release builds.
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            ++failures; \
+        } \
+    } while (false)
+
+namespace {
+
+    int failures = 0;
+
+    // ---- Listeners ----
+
+    int counter = 0;
+
+    void AddValue(int value) { counter += value; }
+    void AddHundred() { counter += 100; }
+
+    struct Receiver {
+        int total = 0;
+        ScopedConnection connection;
+
+        void OnValue(int value) { total += value; }
+        void OnAny() { total += 10; }
+        virtual void OnVirtual(int value) { total += 2 * value; }
+        virtual ~Receiver() = default;
+    };
+
+    struct Payload {
+        static int copies;
+        int value = 0;
+
+        Payload() = default;
+        Payload(const Payload& other) : value(other.value) { ++copies; }
+        Payload(Payload&& other) noexcept : value(other.value) {}
+    };
+    int Payload::copies = 0;
+
+    void PayloadByReference(const Payload& payload) { counter += payload.value; }
+    void PayloadByValue(Payload payload) { counter += payload.value; }
+
+    // ---- Tests ----
+
+    void TestFunctionsAndMethods() {
+        counter = 0;
+        Event<int> event;
+        Receiver receiver;
+        event.AddListener(&AddValue);
+        event.AddListener(&AddHundred);
+        event.AddListener(&receiver, &Receiver::OnValue);
+        event.AddListener(&receiver, &Receiver::OnAny);
+        event.AddListener(&receiver, &Receiver::OnVirtual);
+        event.Trigger(1);
+        CHECK(counter == 101);
+        CHECK(receiver.total == 13);
+
+        event.RemoveListener(&AddHundred);
+        event.RemoveListener(&receiver, &Receiver::OnAny);
+        event.Trigger(1);
+        CHECK(counter == 102);
+        CHECK(receiver.total == 16);
+
+        Event<> noArgument;
+        noArgument.AddListener(&AddHundred);
+        noArgument.AddListener(&receiver, &Receiver::OnAny);
+        noArgument.Trigger();
+        CHECK(counter == 202);
+        CHECK(receiver.total == 26);
+    }
+
+    void TestConnections() {
+        Event<int> event;
+        std::vector<Receiver> receivers(100);
+        std::vector<Connection> connections;
+        for (Receiver& receiver : receivers)
+            connections.push_back(event.AddListener(&receiver, &Receiver::OnValue));
+
+        for (std::size_t i = 0; i < connections.size(); i += 2)
+            CHECK(event.RemoveListener(connections[i]));
+        CHECK(!event.RemoveListener(connections[0]));
+        CHECK(!event.IsConnected(connections[0]));
+        CHECK(event.IsConnected(connections[1]));
+
+        // A reused slot must not be reachable through the stale connection.
+        Connection reused = event.AddListener(&receivers[0], &Receiver::OnValue);
+        CHECK(event.IsConnected(reused));
+        CHECK(!event.IsConnected(connections[0]));
+
+        // Every event has a first slot, a connection must only reach the event it came from.
+        Event<int> other;
+        other.AddListener(&receivers[0], &Receiver::OnValue);
+        Connection foreign = other.AddListener(&receivers[0], &Receiver::OnValue); // same slot as connections[1]
+        CHECK(!event.IsConnected(foreign));
+        CHECK(!event.RemoveListener(foreign));
+        CHECK(!event.SetParallelSafe(foreign));
+        CHECK(other.IsConnected(foreign));
+
+        event.Trigger(1);
+        int total = 0;
+        for (const Receiver& receiver : receivers)
+            total += receiver.total;
+        CHECK(total == 51);
+
+        CHECK(reused.Disconnect());
+        CHECK(!reused.Disconnect());
+        event.RemoveAllListeners();
+        CHECK(!event.IsConnected(connections[1]));
+    }
+
+    void TestScopedConnections() {
+        Event<int> event;
+        {
+            Receiver receiver;
+            receiver.connection = event.AddListener(&receiver, &Receiver::OnValue);
+            event.Trigger(2);
+            CHECK(receiver.total == 2);
+        }
+        event.Trigger(1); // the receiver removed itself when destroyed
+
+        Receiver receiver;
+        ScopedConnection late;
+        ConnectionGroup group;
+        {
+            auto owned = std::make_unique<Event<int>>();
+            late = owned->AddListener(&receiver, &Receiver::OnValue);
+            for (int i = 0; i < 10; ++i)
+                group += owned->AddListener(&receiver, &Receiver::OnValue);
+
+            Event<int> moved(std::move(*owned));
+            moved.Trigger(1);
+            CHECK(receiver.total == 11);
+            group.DisconnectAll();
+            moved.Trigger(1);
+            CHECK(receiver.total == 12);
+        }
+        CHECK(!late.IsConnected());
+    }
+
+    void TestReentrancy() {
+        Event<int> event;
+
+        struct OneShot {
+            Event<int>* event;
+            Connection connection;
+            int calls = 0;
+            void OnValue(int) { ++calls; event->RemoveListener(connection); }
+        };
+        std::vector<OneShot> oneShots(10, OneShot{ &event, Connection{}, 0 });
+        for (OneShot& oneShot : oneShots)
+            oneShot.connection = event.AddListener(&oneShot, &OneShot::OnValue);
+        event.Trigger(0);
+        event.Trigger(0);
+        for (const OneShot& oneShot : oneShots)
+            CHECK(oneShot.calls == 1);
+
+        struct Nested {
+            Event<int>* event;
+            int calls = 0;
+            void OnValue(int depth) { ++calls; if (depth > 0) event->Trigger(depth - 1); }
+        } nested{ &event };
+        event.AddListener(&nested, &Nested::OnValue);
+        event.Trigger(2);
+        CHECK(nested.calls == 3);
+
+        struct Clearer {
+            Event<int>* event;
+            void OnValue(int) { event->RemoveAllListeners(); }
+        } clearer{ &event };
+        Receiver receiver;
+        event.AddListener(&clearer, &Clearer::OnValue, 1);
+        event.AddListener(&receiver, &Receiver::OnValue);
+        event.Trigger(1);
+        CHECK(receiver.total == 0);
+    }
+
+    void TestPriorities() {
+        std::string order;
+        struct Named {
+            std::string* order;
+            char name;
+            void OnValue(int) { *order += name; }
+        };
+        Named a{ &order, 'a' }, b{ &order, 'b' }, c{ &order, 'c' }, d{ &order, 'd' };
+        Event<int> event;
+        event.AddListener(&a, &Named::OnValue);
+        event.AddListener(&b, &Named::OnValue, 5);
+        Connection low = event.AddListener(&c, &Named::OnValue, -1);
+        event.AddListener(&d, &Named::OnValue, 5);
+        event.Trigger(0);
+        CHECK(order == "bdac");
+
+        order.clear();
+        event.RemoveListener(low);
+        event.Trigger(0);
+        CHECK(order == "bda");
+    }
+
+    void TestArgumentPassing() {
+        counter = 0;
+        Payload::copies = 0;
+        Event<Payload> event;
+        for (int i = 0; i < 10; ++i)
+            event.AddListener(&PayloadByReference);
+        Payload payload;
+        payload.value = 1;
+        event.Trigger(payload);
+        CHECK(Payload::copies == 0);
+        CHECK(counter == 10);
+
+        event.AddListener(&PayloadByValue);
+        Payload moved = payload;
+        Payload::copies = 0;
+        event.TriggerMove(std::move(moved));
+        CHECK(Payload::copies == 0); // the last listener takes the argument by move
+
+        // A referenced argument belongs to the caller and is never moved from.
+        struct Keeper {
+            std::string kept;
+            void OnText(std::string text) { kept = std::move(text); }
+        };
+        Keeper keeper;
+        Keeper* keepers[] = { &keeper };
+        Event<const std::string&> byReference;
+        byReference.AddListeners(keepers, 1, &Keeper::OnText);
+        const std::string original = "text";
+        byReference.TriggerMove(original);
+        CHECK(original == "text");
+        CHECK(keeper.kept == "text");
+    }
+
+    void TestResultEvent() {
+        struct Handler {
+            bool handles;
+            int calls = 0;
+            bool OnKey(int) { ++calls; return handles; }
+        };
+        Handler first{ false }, second{ true }, third{ true };
+        ResultEvent<bool(int)> event;
+        event.AddListener(&first, &Handler::OnKey);
+        event.AddListener(&second, &Handler::OnKey);
+        event.AddListener(&third, &Handler::OnKey);
+        CHECK(event.Trigger<collect::AnyOf<bool>>(0));
+        CHECK(third.calls == 0);
+        CHECK(!event.Trigger<collect::AllOf<bool>>(0));
+        CHECK(event.Trigger<collect::Vector<bool>>(0).size() == 3);
+
+        struct Doubler {
+            int Double(int value) { return 2 * value; }
+        } doubler;
+        ResultEvent<int(int)> sum;
+        sum.AddListener(&doubler, &Doubler::Double);
+        sum.AddListener(&doubler, &Doubler::Double);
+        CHECK(sum.Trigger<collect::Sum<int>>(3) == 12);
+    }
+
+    void TestStaticEvent() {
+        counter = 0;
+        using OnValue = StaticEvent<void(int), &AddValue, &AddHundred>;
+        static_assert(OnValue::ListenerCount == 2, "Listener count");
+        OnValue::Trigger(1);
+        CHECK(counter == 101);
+        OnValue event;
+        event.Trigger(2);
+        CHECK(counter == 203);
+        OnValue::With<&AddValue>::Trigger(3);
+        CHECK(counter == 309);
+    }
+
+    void TestEventBus() {
+        struct Collision { int a, b; };
+        struct Score { std::string player; int points; };
+        struct Game {
+            int collisions = 0;
+            int points = 0;
+            void OnCollision(Collision collision) { collisions += collision.a + collision.b; }
+            void OnScore(const Score& score) { points += score.points; }
+        } game;
+
+        EventBus bus;
+        bus.Publish(Collision{ 1, 2 }); // no subscriber yet
+        CHECK(bus.FindEvent<Collision>() == nullptr);
+
+        Connection collision = bus.Subscribe<Collision>(&game, &Game::OnCollision);
+        bus.Subscribe<Score>(&game, &Game::OnScore);
+        bus.Publish(Collision{ 1, 2 });
+        bus.Emplace<Score>(Score{ "p1", 10 });
+        CHECK(game.collisions == 3);
+        CHECK(game.points == 10);
+
+        EventBus moved(std::move(bus));
+        CHECK(collision.Disconnect());
+        moved.Publish(Collision{ 1, 2 });
+        CHECK(game.collisions == 3);
+        moved.Unsubscribe<Score>(&game, &Game::OnScore);
+        moved.Publish(Score{ "p1", 10 });
+        CHECK(game.points == 10);
+    }
+
+    void TestTopicBus() {
+        CHECK(TopicBus<>::Matches("net.*", "net.tcp.open"));
+        CHECK(!TopicBus<>::Matches("net.*", "net"));
+        CHECK(TopicBus<>::Matches("*.error", "net.error"));
+        CHECK(!TopicBus<>::Matches("*.error", "net.tcp.error"));
+
+        std::string log;
+        struct Logger {
+            std::string* log;
+            char name;
+            void OnValue(int value) { *log += name; *log += std::to_string(value); }
+        };
+        Logger exact{ &log, 'e' }, wildcard{ &log, 'w' };
+        TopicBus<int> bus;
+        bus.Subscribe("net.connect", &exact, &Logger::OnValue);
+        bus.Subscribe("net.*", &wildcard, &Logger::OnValue);
+        TopicBus<int>::TopicId open = bus.Intern("net.tcp.open");
+        bus.Publish("net.connect", 1);
+        bus.Publish(open, 2);
+        bus.Publish("net.unknown", 3);
+        bus.Publish("other", 4);
+        CHECK(log == "e1w1w2w3");
+
+        for (int i = 0; i < 1000; ++i)
+            bus.Intern("topic." + std::to_string(i));
+        CHECK(bus.Freeze());
+        bool allFound = true;
+        for (int i = 0; i < 1000; ++i) {
+            std::string topic = "topic." + std::to_string(i);
+            TopicBus<int>::TopicId id = bus.Find(topic);
+            allFound = allFound && id != TopicBus<int>::InvalidTopic && bus.Name(id) == topic;
+        }
+        CHECK(allFound);
+        CHECK(bus.Find("topic.1000") == TopicBus<int>::InvalidTopic);
+        CHECK(bus.Find("net.tcp.open") == open);
+    }
+
+    void TestIdentityIndex() {
+        struct Counter {
+            int calls = 0;
+            void OnValue(int) { ++calls; }
+            void OnOther(int) { ++calls; }
+        };
+        std::vector<Counter> counters(200);
+        Event<int> event;
+        for (Counter& counter : counters) {
+            event.AddListener(&counter, &Counter::OnValue);
+            event.AddListener(&counter, &Counter::OnOther);
+        }
+        event.AddListener(&counters[0], &Counter::OnValue, 1); // same identity twice
+        for (std::size_t i = 0; i < counters.size(); i += 2)
+            event.RemoveListener(&counters[i], &Counter::OnValue);
+        Event<int> copy(event);
+        copy.Trigger(1);
+        int calls = 0;
+        for (const Counter& counter : counters)
+            calls += counter.calls;
+        CHECK(calls == 300);
+        CHECK(counters[0].calls == 1);
+
+        // Removal by identity from a listener, while the event is dispatching.
+        struct Remover {
+            Event<int>* event;
+            std::vector<Counter>* counters;
+            void OnValue(int) {
+                for (Counter& counter : *counters)
+                    event->RemoveListener(&counter, &Counter::OnOther);
+            }
+        } remover{ &copy, &counters };
+        copy.AddListener(&remover, &Remover::OnValue, 2);
+        for (Counter& counter : counters)
+            counter.calls = 0;
+        copy.Trigger(1);
+        calls = 0;
+        for (const Counter& counter : counters)
+            calls += counter.calls;
+        CHECK(calls == 100);
+    }
+
+    void TestBatches() {
+        std::string log;
+        struct Logger {
+            std::string* log;
+            char name;
+            void OnValue(int) { *log += name; }
+            void OnOther(int) { *log += static_cast<char>(name - 'a' + 'A'); }
+        };
+        Logger a{ &log, 'a' }, b{ &log, 'b' }, c{ &log, 'c' };
+        Logger* loggers[] = { &a, &b, &c };
+        Event<int> event;
+        event.AddListener(&a, &Logger::OnOther);
+        Connection connections[3];
+        event.AddListeners(loggers, 3, &Logger::OnValue, 1, connections);
+        event.Trigger(0);
+        CHECK(log == "abcA");
+
+        event.RemoveListeners(loggers + 1, 2, &Logger::OnValue);
+        CHECK(event.RemoveListeners(connections, 3) == 1);
+        CHECK(event.RemoveAllListenersOf(&a) == 1);
+        log.clear();
+        event.Trigger(0);
+        CHECK(log.empty());
+
+        SubscriptionRegistry registry;
+        Event<int> other;
+        registry.Subscribe(event, &a, &Logger::OnValue);
+        registry.Subscribe(other, &a, &Logger::OnOther);
+        registry.Subscribe(other, &b, &Logger::OnValue, 1);
+        {
+            Event<int> temporary;
+            registry.Subscribe(temporary, &a, &Logger::OnValue); // event destroyed first
+        }
+        CHECK(registry.InstanceCount() == 2);
+        CHECK(registry.UnsubscribeAll(&a));
+        CHECK(!registry.UnsubscribeAll(&a));
+        log.clear();
+        event.Trigger(0);
+        other.Trigger(0);
+        CHECK(log == "b");
+    }
+
+    void TestWeakListeners() {
+        std::string log;
+        struct Logger {
+            std::string* log;
+            char name;
+            LifetimeToken lifetime;
+            void OnValue(int) { *log += name; }
+        };
+        auto shared = std::make_shared<Logger>(Logger{ &log, 's', {} });
+        Logger tracked{ &log, 't', {} };
+        Event<int> event;
+        event.AddListener(shared, &Logger::OnValue);
+        event.AddListener(&tracked, &Logger::OnValue, tracked.lifetime, 1);
+        event.Trigger(0);
+        CHECK(log == "ts");
+
+        // An object destroyed by a listener is skipped by the same dispatch.
+        struct Releaser {
+            std::shared_ptr<Logger>* shared;
+            void OnValue(int) { shared->reset(); }
+        } releaser{ &shared };
+        event.AddListener(&releaser, &Releaser::OnValue, 2);
+        tracked.lifetime.Reset();
+        log.clear();
+        event.Trigger(0);
+        CHECK(log.empty());
+        CHECK(event.PruneExpiredListeners() == 2);
+
+        {
+            Logger scoped{ &log, 'x', {} };
+            event.AddListener(&scoped, &Logger::OnValue, scoped.lifetime);
+        }
+        event.RemoveListener(&releaser, &Releaser::OnValue);
+        Event<int> copy(event);
+        copy.Trigger(0);
+        CHECK(log.empty());
+    }
+
+    void TestMemberIdentity() {
+        std::string log;
+        // Both bases declare their method in the same vtable slot, so the first word of the member
+        // pointers is the same offset and only their this adjustment differs.
+        struct Left {
+            std::string* log;
+            explicit Left(std::string* log) : log(log) {}
+            virtual ~Left() = default;
+            virtual void OnValue(int) { *log += 'l'; }
+        };
+        struct Right {
+            std::string* log;
+            explicit Right(std::string* log) : log(log) {}
+            virtual ~Right() = default;
+            virtual void OnOther(int) { *log += 'r'; }
+        };
+        struct Both : Left, Right {
+            explicit Both(std::string* log) : Left(log), Right(log) {}
+            void OnValue(int) override { *Left::log += 'L'; }
+        };
+        using Method = void (Both::*)(int);
+        Both both(&log);
+        Event<int> event;
+        event.AddListener(&both, static_cast<Method>(&Left::OnValue));
+        event.AddListener(&both, static_cast<Method>(&Right::OnOther));
+        event.RemoveListener(&both, static_cast<Method>(&Right::OnOther));
+        event.Trigger(0);
+        CHECK(log == "L");
+
+        // Same through the identity index.
+        std::vector<Both> others(40, Both(&log));
+        for (Both& other : others)
+            event.AddListener(&other, static_cast<Method>(&Right::OnOther));
+        event.AddListener(&both, static_cast<Method>(&Right::OnOther));
+        event.RemoveListener(&both, static_cast<Method>(&Left::OnValue));
+        for (Both& other : others)
+            event.RemoveListener(&other, static_cast<Method>(&Right::OnOther));
+        log.clear();
+        event.Trigger(0);
+        CHECK(log == "r");
+
+        ConcurrentEvent<int> concurrent;
+        concurrent.AddListener(&both, static_cast<Method>(&Left::OnValue));
+        concurrent.AddListener(&both, static_cast<Method>(&Right::OnOther));
+        concurrent.RemoveListener(&both, static_cast<Method>(&Left::OnValue));
+        log.clear();
+        concurrent.Trigger(0);
+        CHECK(log == "r");
+    }
+
+    void TestSmallEvent() {
+        std::string log;
+        struct Logger {
+            std::string* log;
+            char name;
+            void OnValue(int value) { *log += name; *log += std::to_string(value); }
+        };
+        Logger a{ &log, 'a' }, b{ &log, 'b' }, c{ &log, 'c' }, d{ &log, 'd' };
+        SmallEvent<2, int> event;
+        Connection first = event.AddListener(&a, &Logger::OnValue);
+        event.AddListener(&b, &Logger::OnValue, 1);
+        event.Trigger(1);
+        CHECK(log == "b1a1");
+
+        event.AddListener(&c, &Logger::OnValue); // spills to the heap
+        event.AddListener(&d, &Logger::OnValue, 2);
+        event.RemoveListener(first);
+        SmallEvent<2, int> copy(event);
+        SmallEvent<2, int> moved(std::move(event));
+        log.clear();
+        copy.Trigger(2);
+        moved.Trigger(3);
+        event.Trigger(4);
+        CHECK(log == "d2b2c2d3b3c3");
+
+        SmallEvent<2, int> inlineOnly;
+        inlineOnly.AddListener(&a, &Logger::OnValue);
+        moved = std::move(inlineOnly);
+        log.clear();
+        moved.Trigger(5);
+        CHECK(log == "a5");
+
+        // A listener spilling the storage to the heap relocates it during the dispatch.
+        struct Spiller {
+            SmallEvent<2, int>* event;
+            Logger* logger;
+            void OnValue(int) { for (int i = 0; i < 8; ++i) event->AddListener(logger, &Logger::OnValue); }
+        };
+        SmallEvent<2, int> spilling;
+        Spiller spiller{ &spilling, &a };
+        spilling.AddListener(&spiller, &Spiller::OnValue);
+        spilling.AddListener(&b, &Logger::OnValue);
+        log.clear();
+        spilling.Trigger(6);
+        CHECK(log == "b6");
+        spilling.RemoveListener(&spiller, &Spiller::OnValue);
+        log.clear();
+        spilling.Trigger(7);
+        CHECK(log == "b7a7a7a7a7a7a7a7a7");
+
+#if !defined(TOOLBOX_EVENT_PROFILING) && !defined(TOOLBOX_EVENT_TRACING)
+        static_assert(sizeof(void*) != 8 || sizeof(Event<int>) == 56, "Event header grew");
+        static_assert(sizeof(void*) != 8 || sizeof(SmallEvent<2, int>) == 56 + (2 * 81 + 7) / 8 * 8, "Inline listener grew");
+#endif
+    }
+
+    void TestAllocator() {
+#if __has_include(<memory_resource>)
+#ifndef TOOLBOX_EVENT_PROFILING
+        // Moves take the storage and never allocate, unless the allocators may differ.
+        static_assert(std::is_nothrow_move_constructible<Event<int>>::value, "Event moves must not throw");
+        static_assert(std::is_nothrow_move_assignable<Event<int>>::value, "Event moves must not throw");
+        static_assert(!std::is_nothrow_move_assignable<PmrEvent<int>>::value, "PmrEvent may move elements");
+#endif
+        std::byte buffer[4096];
+        std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+        int total = 0;
+        struct Accumulator {
+            int* total;
+            void OnValue(int value) { *total += value; }
+        } accumulator{ &total };
+        PmrEvent<int> event(&arena);
+        for (int i = 0; i < 8; ++i)
+            event.AddListener(&accumulator, &Accumulator::OnValue, i);
+        event.Trigger(1);
+        CHECK(total == 8);
+
+        EventQueue<int> queue;
+        queue.Enqueue(2);
+        queue.Flush(event);
+        CHECK(total == 24);
+
+        // Removing many instances sorts them in scratch storage taken from the event allocator.
+        struct CountingResource : std::pmr::memory_resource {
+            int allocations = 0;
+            void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+                ++allocations;
+                return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+            }
+            void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override {
+                std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+            }
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+                return this == &other;
+            }
+        } counting;
+        PmrEvent<int> removal(&counting);
+        removal.AddListener(&accumulator, &Accumulator::OnValue);
+        Accumulator* instances[] = { &accumulator };
+        const int allocations = counting.allocations;
+        removal.RemoveListeners(instances, 1, &Accumulator::OnValue);
+        CHECK(counting.allocations == allocations + 1);
+
+        // Weak listeners and the identity index move to an event using another resource.
+        std::pmr::unsynchronized_pool_resource sourcePool, targetPool;
+        PmrEvent<int> source(&sourcePool);
+        auto shared = std::make_shared<Accumulator>(Accumulator{ &total });
+        source.AddListener(shared, &Accumulator::OnValue);
+        for (int i = 0; i < 40; ++i)
+            source.AddListener(&accumulator, &Accumulator::OnValue);
+        PmrEvent<int> target(&targetPool);
+        target = std::move(source);
+        shared.reset();
+        total = 0;
+        target.Trigger(1);
+        CHECK(total == 40);
+        target.RemoveListener(&accumulator, &Accumulator::OnValue);
+        CHECK(target.PruneExpiredListeners() == 1);
+        target.Trigger(1);
+        CHECK(total == 40);
+#endif
+    }
+
+    void TestEventQueue() {
+        std::string log;
+        struct Logger {
+            std::string* log;
+            char name;
+            void OnValue(int value) { *log += name; *log += std::to_string(value); }
+        };
+        Logger a{ &log, 'a' }, b{ &log, 'b' };
+        Event<int> event;
+        event.AddListener(&a, &Logger::OnValue);
+        event.AddListener(&b, &Logger::OnValue);
+
+        EventQueue<int> queue;
+        queue.Enqueue(1);
+        queue.EnqueueCoalesced(1);
+        queue.Enqueue(2);
+        queue.Enqueue(1);
+        CHECK(queue.Size() == 3);
+        queue.Deduplicate();
+        CHECK(queue.Size() == 2);
+        queue.Flush(event);
+        CHECK(log == "a1b1a2b2");
+        CHECK(queue.Empty());
+
+        log.clear();
+        queue.Enqueue(1);
+        queue.Enqueue(2);
+        queue.Flush(event, FlushOrder::ListenerByListener);
+        CHECK(log == "a1a2b1b2");
+    }
+
+    void TestEventChannel() {
+        std::atomic<long> total{ 0 };
+        struct Accumulator {
+            std::atomic<long>* total;
+            void OnValue(int value) { *total += value; }
+        } accumulator{ &total };
+        Event<int> event;
+        event.AddListener(&accumulator, &Accumulator::OnValue);
+
+        MpscEventChannel<int> channel(256);
+        constexpr int Producers = 4, PerProducer = 10000;
+        std::vector<std::thread> producers;
+        for (int i = 0; i < Producers; ++i)
+            producers.emplace_back([&channel] { for (int j = 0; j < PerProducer; ++j) channel.Push(1); });
+        std::size_t drained = 0;
+        while (drained < Producers * PerProducer)
+            drained += channel.Drain(event);
+        for (std::thread& producer : producers)
+            producer.join();
+        CHECK(total == Producers * PerProducer);
+
+        // Drained payloads are released before Drain returns.
+        Event<std::shared_ptr<int>> sharedEvent;
+        MpscEventChannel<std::shared_ptr<int>> sharedChannel(4);
+        auto payload = std::make_shared<int>(1);
+        sharedChannel.Push(payload);
+        CHECK(sharedChannel.Drain(sharedEvent) == 1);
+        CHECK(payload.use_count() == 1);
+    }
+
+    void TestConcurrentEvent() {
+        struct Counter {
+            std::atomic<long> total{ 0 };
+            void OnValue(int value) { total += value; }
+        } counter;
+        ConcurrentEvent<int> event;
+        Connection connection = event.AddListener(&counter, &Counter::OnValue);
+        event.Trigger(1);
+        CHECK(counter.total == 1);
+        ConcurrentEvent<int> other;
+        Connection foreign = other.AddListener(&counter, &Counter::OnValue); // same id as connection
+        CHECK(!event.IsConnected(foreign));
+        CHECK(!event.RemoveListener(foreign));
+        CHECK(event.RemoveListener(connection));
+        event.Trigger(1);
+        CHECK(counter.total == 1);
+
+        std::atomic<bool> stop{ false };
+        std::vector<std::thread> triggers;
+        for (int i = 0; i < 4; ++i)
+            triggers.emplace_back([&] { while (!stop) event.Trigger(1); });
+        for (int i = 0; i < 1000; ++i)
+            event.RemoveListener(event.AddListener(&counter, &Counter::OnValue));
+        stop = true;
+        for (std::thread& trigger : triggers)
+            trigger.join();
+        event.Synchronize();
+
+        // Reader slots are held for one dispatch only, so more threads than slots may trigger while alive.
+        const std::size_t threadCount = event_detail::EpochDomain::MaxReaders + 16;
+        std::atomic<std::size_t> triggered{ 0 };
+        std::atomic<bool> release{ false };
+        std::vector<std::thread> readers;
+        for (std::size_t i = 0; i < threadCount; ++i) {
+            readers.emplace_back([&] {
+                event.Trigger(1);
+                ++triggered;
+                while (!release)
+                    std::this_thread::yield();
+            });
+        }
+        while (triggered != threadCount)
+            std::this_thread::yield();
+        release = true;
+        for (std::thread& reader : readers)
+            reader.join();
+    }
+
+    void TestParallelTrigger() {
+        WorkStealingPool pool(4);
+        std::atomic<int> hits{ 0 };
+        struct Worker {
+            std::atomic<int>* hits;
+            void OnValue(int value) { *hits += value; }
+        };
+        std::vector<Worker> workers(200, Worker{ &hits });
+        Event<int> event;
+        for (Worker& worker : workers)
+            event.SetParallelSafe(event.AddListener(&worker, &Worker::OnValue));
+        int serial = 0;
+        struct Serial {
+            int* serial;
+            void OnValue(int) { ++*serial; }
+        } serialListener{ &serial };
+        event.AddListener(&serialListener, &Serial::OnValue);
+
+        event.TriggerParallel(pool, 1);
+        CHECK(hits == 200);
+        CHECK(serial == 1);
+
+        std::atomic<int> nested{ 0 };
+        pool.ParallelFor(20, [&](std::size_t) { pool.ParallelFor(10, [&](std::size_t) { ++nested; }); });
+        CHECK(nested == 200);
+
+        // Detached tasks check weak listeners again when they run, not only when they are submitted.
+        struct DeferredExecutor {
+            std::vector<std::function<void()>> tasks;
+            std::size_t ThreadCount() const { return 1; }
+            void Submit(std::function<void()> task) { tasks.push_back(std::move(task)); }
+        } deferred;
+        int calls = 0;
+        struct Target {
+            int* calls;
+            void OnValue(int value) { *calls += value; }
+        };
+        auto expiring = std::make_shared<Target>(Target{ &calls });
+        auto kept = std::make_shared<Target>(Target{ &calls });
+        Event<int> detached;
+        detached.AddListener(expiring, &Target::OnValue);
+        detached.SetParallelSafe(detached.AddListener(kept, &Target::OnValue));
+        detached.TriggerParallelDetached(deferred, 1);
+        expiring.reset();
+        for (std::function<void()>& task : deferred.tasks)
+            task();
+        CHECK(calls == 1);
+    }
+
+    struct Test {
+        const char* name;
+        void (*function)();
+    };
+
+    const Test tests[] = {
+        { "FunctionsAndMethods", &TestFunctionsAndMethods },
+        { "Connections", &TestConnections },
+        { "ScopedConnections", &TestScopedConnections },
+        { "Reentrancy", &TestReentrancy },
+        { "Priorities", &TestPriorities },
+        { "ArgumentPassing", &TestArgumentPassing },
+        { "ResultEvent", &TestResultEvent },
+        { "EventQueue", &TestEventQueue },
+        { "EventChannel", &TestEventChannel },
+        { "ConcurrentEvent", &TestConcurrentEvent },
+        { "ParallelTrigger", &TestParallelTrigger },
+        { "StaticEvent", &TestStaticEvent },
+        { "EventBus", &TestEventBus },
+        { "TopicBus", &TestTopicBus },
+        { "IdentityIndex", &TestIdentityIndex },
+        { "Batches", &TestBatches },
+        { "WeakListeners", &TestWeakListeners },
+        { "MemberIdentity", &TestMemberIdentity },
+        { "SmallEvent", &TestSmallEvent },
+        { "Allocator", &TestAllocator },
+    };
+
+}
+
+int main(int argc, char** argv) {
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    int run = 0;
+    for (const Test& test : tests) {
+        if (filter && std::strcmp(filter, test.name) != 0)
+            continue;
+        int failuresBefore = failures;
+        test.function();
+        std::printf("[%s] %s\n", failures == failuresBefore ? "PASS" : "FAIL", test.name);
+        ++run;
+    }
+    if (run == 0) {
+        std::fprintf(stderr, "No test named %s\n", filter);
+        return 2;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file EventTracingTests.cpp
+ * @brief Tests of the dispatch spans recorded when TOOLBOX_EVENT_TRACING is defined.
+ */
+
+#ifndef TOOLBOX_EVENT_TRACING
+#define TOOLBOX_EVENT_TRACING
+#endif
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "Event.h"
+
+/// Report a failed condition without stopping the test, unlike assert it is kept in release builds.
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            ++failures; \
+        } \
+    } while (false)
+
+namespace {
+
+    int failures = 0;
+
+    std::size_t CountOf(const std::string& text, const std::string& pattern) {
+        std::size_t count = 0;
+        for (std::size_t position = text.find(pattern); position != std::string::npos; position = text.find(pattern, position + 1))
+            ++count;
+        return count;
+    }
+
+    struct Cascade {
+        Event<int>* next;
+        void OnValue(int value) { next->Trigger(value); }
+    };
+
+    void Leaf(int) {}
+
+    void TestCascade() {
+        Event<int> input, output;
+        input.SetTraceName("Input");
+        output.SetTraceName("Output \"quoted\"");
+        Cascade cascade{ &output };
+        input.AddListener(&cascade, &Cascade::OnValue);
+        output.AddListener(&Leaf);
+
+        input.Trigger(0); // not recorded before Start
+        EventTracer::Start();
+        input.Trigger(1);
+        std::thread([&output] { output.Trigger(2); }).join();
+        EventTracer::Stop();
+        input.Trigger(3);
+
+        std::ostringstream trace;
+        EventTracer::WriteChromeTrace(trace);
+        std::string json = trace.str();
+        CHECK(CountOf(json, "\"ph\":\"X\"") == 6);
+        CHECK(CountOf(json, "\"name\":\"Input\"") == 2);
+        CHECK(CountOf(json, "\"name\":\"Output \\\"quoted\\\"\"") == 4);
+        CHECK(CountOf(json, "\"cat\":\"listener\"") == 3);
+        CHECK(CountOf(json, "\"tid\":1") == 2);
+        CHECK(EventTracer::DroppedCount() == 0);
+
+        EventTracer::Clear();
+        std::ostringstream empty;
+        EventTracer::WriteChromeTrace(empty);
+        CHECK(CountOf(empty.str(), "\"ph\"") == 0);
+    }
+
+    void TestCopiedName() {
+        Event<int> named;
+        named.SetTraceName("Named");
+        Event<int> constructed(named), assigned, moveAssigned;
+        assigned = named;
+        moveAssigned = Event<int>(named);
+
+        EventTracer::Start();
+        constructed.Trigger(0);
+        assigned.Trigger(0);
+        moveAssigned.Trigger(0);
+        EventTracer::Stop();
+
+        std::ostringstream trace;
+        EventTracer::WriteChromeTrace(trace);
+        CHECK(CountOf(trace.str(), "\"name\":\"Named\"") == 3);
+        EventTracer::Clear();
+    }
+
+}
+
+int main() {
+    TestCascade();
+    TestCopiedName();
+    std::printf("%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}